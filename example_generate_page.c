@@ -1,6 +1,6 @@
 // example_generate_page.c
 // Build:
-//   gcc -std=c99 -O2 -Wall -Wextra -pedantic sudoku_module.c example_generate_page.c -o gen_page
+//   gcc -std=c99 -O2 -Wall -Wextra -pedantic sudoku_module.c sudoku_cdcl.c sudoku_template.c example_generate_page.c -o gen_page
 //
 // Run:
 //   ./gen_page
@@ -7,6 +7,8 @@
 //optional validation if the page provides data-solution="81 digits"
 //start/pause/reset timer buttons
 //mistakes counter (max 3) when solution is available
+//optional "Show me" replay if the page provides data-trace="base64 solve trace"
+//compact pages (data-puzzle="81 chars") get their cells built here instead of shipping 81 divs
 
 (function () {
   "use strict";
@@ -33,11 +35,88 @@
     return cleaned;
   }
 
+  const TECHNIQUE_NAMES = [
+    "hidden single",
+    "naked single",
+    "locked candidates",
+    "naked pair",
+    "hidden pair",
+    "x-wing",
+    "guess"
+  ];
+
+  function parseTrace(s) {
+    //3 bytes per step (same layout as SudokuTrace in sudoku_grade.h):
+    //technique << 4 | digit, cell (255 = none), unit (255 = none)
+    if (!s || !window.atob) return null;
+    let raw;
+    try {
+      raw = window.atob(String(s).replace(/\s+/g, ""));
+    } catch (e) {
+      return null;
+    }
+    if (raw.length === 0 || raw.length % 3 !== 0) return null;
+    const steps = [];
+    for (let i = 0; i < raw.length; i += 3) {
+      const b0 = raw.charCodeAt(i);
+      steps.push({
+        technique: b0 >> 4,
+        digit: b0 & 15,
+        cell: raw.charCodeAt(i + 1),
+        unit: raw.charCodeAt(i + 2)
+      });
+    }
+    return steps;
+  }
+
+  function unitCells(u) {
+    //0..8 rows, 9..17 cols, 18..26 boxes
+    const out = [];
+    for (let k = 0; k < 9; k++) {
+      if (u < 9) out.push(u * 9 + k);
+      else if (u < 18) out.push(k * 9 + (u - 9));
+      else {
+        const b = u - 18;
+        out.push((Math.floor(b / 3) * 3 + Math.floor(k / 3)) * 9 + (b % 3) * 3 + (k % 3));
+      }
+    }
+    return out;
+  }
+
+  function unitLabel(u) {
+    if (u < 9) return `row ${u + 1}`;
+    if (u < 18) return `column ${u - 8}`;
+    return `box ${u - 17}`;
+  }
+
+  function buildCells(container) {
+    //one fragment, one insertion; also keeps the references so nothing has to be queried
+    const puzzle = container.getAttribute("data-puzzle");
+    if (!puzzle || !/^[0-9.]{81}$/.test(puzzle)) return null;
+    const fragment = document.createDocumentFragment();
+    const cells = [];
+    for (let i = 0; i < 81; i++) {
+      const cell = document.createElement("div");
+      const ch = puzzle[i];
+      if (ch >= "1" && ch <= "9") {
+        cell.className = "cell given";
+        cell.textContent = ch;
+      } else {
+        cell.className = "cell empty";
+      }
+      fragment.appendChild(cell);
+      cells.push(cell);
+    }
+    container.textContent = ""; //drops the <noscript> fallback grid
+    container.appendChild(fragment);
+    return cells;
+  }
+
   document.addEventListener("DOMContentLoaded", function () {
     const container = document.querySelector(".game .container");
     if (!container) return;
 
-    const cells = Array.from(container.querySelectorAll(".cell"));
+    const cells = buildCells(container) || Array.from(container.querySelectorAll(".cell"));
     if (cells.length !== 81) return;
 
     const solution = parseSolutionString(container.getAttribute("data-solution"));
@@ -56,6 +135,8 @@
     const resetBtn =
       btns.find((b) => b.getAttribute("data-action") === "reset") ||
       btns.find((b) => (b.textContent || "").trim().toLowerCase() === "reset");
+    const replayBtn = btns.find((b) => b.getAttribute("data-action") === "replay");
+    const trace = parseTrace(container.getAttribute("data-trace"));
 
     let selectedIdx = -1;
     let started = false;
@@ -270,6 +351,7 @@
     }
 
     function resetGame() {
+      stopReplay();
       pauseTimer();
       seconds = 0;
       mistakes = 0;
@@ -296,6 +378,66 @@
       });
     if (resetBtn) resetBtn.addEventListener("click", resetGame);
 
+    //"show me how": replays the grader's steps (no solving in the browser)
+    let replayTimer = null;
+    let replayNote = null;
+
+    function clearHints() {
+      cells.forEach((cell) => cell.classList.remove("hint-unit", "hint-cell"));
+    }
+
+    function stopReplay() {
+      if (replayTimer) window.clearInterval(replayTimer);
+      replayTimer = null;
+      clearHints();
+      if (replayNote) replayNote.textContent = "";
+    }
+
+    function startReplay() {
+      if (!trace) return;
+      resetGame();
+      cells.forEach((cell) => {
+        if (cell.classList.contains("editable")) cell.classList.add("locked");
+      });
+      if (!replayNote) {
+        replayNote = document.createElement("div");
+        replayNote.className = "replay-note";
+        container.parentNode.appendChild(replayNote);
+      }
+
+      let i = 0;
+      replayTimer = window.setInterval(function () {
+        clearHints();
+        if (i >= trace.length) {
+          window.clearInterval(replayTimer);
+          replayTimer = null;
+          replayNote.textContent = "Solved! Press Reset to play.";
+          return;
+        }
+        const step = trace[i++];
+        const name = TECHNIQUE_NAMES[step.technique] || "step";
+        if (step.unit < 27) {
+          unitCells(step.unit).forEach((idx) => cells[idx].classList.add("hint-unit"));
+        }
+        let text = `Step ${i}/${trace.length}: ${name}`;
+        if (step.cell < 81) {
+          const cell = cells[step.cell];
+          cell.textContent = String(step.digit);
+          cell.classList.add("hint-cell", "correct");
+          text += ` -> ${step.digit}`;
+        } else {
+          text += ` removes ${step.digit}`;
+        }
+        if (step.unit < 27) text += ` (${unitLabel(step.unit)})`;
+        replayNote.textContent = text;
+      }, 600);
+    }
+
+    if (replayBtn) {
+      if (trace) replayBtn.addEventListener("click", startReplay);
+      else replayBtn.style.display = "none";
+    }
+
     function applyDifficulty(name) {
       if (name === currentDifficulty) return;
       currentDifficulty = name;
@@ -7,7 +7,7 @@
 //the pages are playable in the browser via sudoku.js (no external dependencies)
 
 // Build:
-//   gcc -std=c99 -O2 -Wall -Wextra -pedantic sudoku_module.c sudoku_app.c -o sudoku_app
+//   gcc -std=c99 -O2 -Wall -Wextra -pedantic sudoku_module.c sudoku_cdcl.c sudoku_grade.c sudoku_masks.c sudoku_store.c sudoku_dedupe.c sudoku_template.c sudoku_app.c -o sudoku_app
 
 // Run (interactive):
 //   ./sudoku_app
@@ -15,7 +15,23 @@
 // Run (non-interactive, generates all pages into current folder):
 //   ./sudoku_app --all
 
+// Options:
+//   --masks sudoku_masks.txt   generate unique puzzles from a clue mask library
+//   --store puzzles.sdb        serve unserved puzzles from a puzzle store (see sudoku_db.c),
+//                              generate only when the store has none left for a difficulty
+//   --seen seen.sdh            never issue a puzzle that is the same (up to symmetry) as one
+//                              issued before; the file is created on first use
+//   --template page.html       page layout from a template file (see sudoku_template.h)
+//   --print-template           print the built-in page template (a starting point) and exit
+//   --theme-css                theme colors in one shared theme-<hash>.css instead of a <style> block per page
+//   --compact                  81 char data-puzzle attribute instead of 81 cell divs (sudoku.js builds them)
+
 #include "sudoku_module.h"
+#include "sudoku_grade.h"
+#include "sudoku_masks.h"
+#include "sudoku_store.h"
+#include "sudoku_dedupe.h"
+#include "sudoku_template.h"
 
 #include <ctype.h>
 #include <stdio.h>
@@ -71,7 +87,10 @@ static const char* difficulty_title_suffix(SudokuDifficulty d) {
 }
 
 static int write_index_html(const char* css_href, const char* title, SudokuDifficulty active) {
-    FILE* f = fopen("index.html", "w");
+    //renamed into place when done, like the puzzle pages
+    char tmp[64];
+    if (!sudoku_temp_path("index.html", tmp, sizeof(tmp))) return 0;
+    FILE* f = fopen(tmp, "w");
     if (!f) return 0;
     fputs("<!DOCTYPE html>\n", f);
     fputs("<html lang=\"en\">\n<head>\n", f);
@@ -108,16 +127,88 @@ static int write_index_html(const char* css_href, const char* title, SudokuDiffi
     fputs("  </main>\n", f);
     fputs("  <footer></footer>\n", f);
     fputs("</body>\n</html>\n", f);
-    fclose(f);
-    return 1;
+    int ok = !ferror(f);
+    if (fclose(f) != 0) ok = 0;
+    if (!ok) {
+        remove(tmp);
+        return 0;
+    }
+    return sudoku_replace_file(tmp, "index.html") == SUDOKU_OK;
+}
+
+//random unserved puzzle of this difficulty from the store (its id, -1 if none)
+//it is marked as served once its page is written, so a rejected candidate stays available
+static int pick_from_store(SudokuStore* store, SudokuDifficulty d, SudokuBoard* puzzle, SudokuBoard* solution) {
+    SudokuStoreQuery q;
+    sudoku_store_query_init(&q);
+    q.difficulty = (int)d;
+    q.unserved_only = 1;
+
+    int id = sudoku_store_pick(store, &q);
+    SudokuStoreEntry e;
+    if (id < 0 || sudoku_store_get(store, id, &e) != SUDOKU_OK) return -1;
+    if (sudoku_count_solutions(&e.puzzle, 1, solution) != 1) return -1;
+    *puzzle = e.puzzle;
+    return id;
 }
 
-static int generate_one(SudokuDifficulty d, const char* css_href, const char* base_title, const SudokuTheme* base_theme) {
+//where puzzles come from (all optional)
+typedef struct PuzzleSources {
+    const SudokuMaskLibrary* masks;
+    SudokuStore* store;
+    SudokuSeenSet* seen;
+} PuzzleSources;
+
+//candidates a source gets to offer before it counts as used up (all of them issued before)
+#define SEEN_RETRIES 20
+
+//where candidates come from, in this order: store (graded, unique), a known-good mask from the
+//library, the simple digging
+enum { SOURCE_STORE, SOURCE_MASKS, SOURCE_DIGGING, SOURCE_COUNT };
+
+//0 = this source has nothing (more) to offer; store_id = the store puzzle offered, or -1
+static int next_puzzle(SudokuDifficulty d, const PuzzleSources* src, int source, SudokuBoard* puzzle, SudokuBoard* solution, int* store_id) {
+    *store_id = -1;
+    if (source == SOURCE_STORE) {
+        if (src->store) *store_id = pick_from_store(src->store, d, puzzle, solution);
+        return *store_id >= 0;
+    }
+    if (source == SOURCE_MASKS) {
+        const SudokuMask* mask = src->masks ? sudoku_mask_library_pick(src->masks, d) : NULL;
+        return mask && sudoku_generate_puzzle_from_mask(mask, puzzle, solution, NULL) == SUDOKU_OK;
+    }
+    return sudoku_generate_puzzle(puzzle, solution, d) == SUDOKU_OK;
+}
+
+//how pages are written (all optional)
+typedef struct PageLayout {
+    const SudokuTemplate* tpl;
+    int compact;
+    const char* theme_css;      // shared theme stylesheet, or null
+} PageLayout;
+
+static int generate_one(SudokuDifficulty d, const char* css_href, const char* base_title, const SudokuTheme* base_theme, const PuzzleSources* src, const PageLayout* layout) {
     SudokuBoard puzzle;
     SudokuBoard solution;
 
-    SudokuResult r = sudoku_generate_puzzle(&puzzle, &solution, d);
-    if (r != SUDOKU_OK) return 0;
+    //the seen check is cheap (~0.1 ms), so it runs before grading and rendering
+    //issued puzzles are rejected; a source that keeps offering them is left for the next one,
+    //and when every source is used up there is no page rather than a repeated one
+    uint64_t hash = 0;
+    SudokuResult r;
+    int found = 0;
+    int store_id = -1;
+    for (int source = 0; source < SOURCE_COUNT && !found; ++source) {
+        for (int attempt = 0; attempt < SEEN_RETRIES && !found; ++attempt) {
+            if (!next_puzzle(d, src, source, &puzzle, &solution, &store_id)) break;
+            if (src->seen) hash = sudoku_canonical_hash(&puzzle);
+            found = !src->seen || !sudoku_seen_contains(src->seen, hash);
+        }
+    }
+    if (!found) {
+        fprintf(stderr, "No %s puzzle that was not issued before\n", difficulty_title_suffix(d));
+        return 0;
+    }
 
     char title_buf[128];
     snprintf(title_buf, sizeof(title_buf), "%s (%s)", base_title ? base_title : "Sudoku", difficulty_title_suffix(d));
@@ -126,15 +217,39 @@ static int generate_one(SudokuDifficulty d, const char* css_href, const char* ba
     if (base_theme) theme = *base_theme;
     theme.page_title = title_buf;
 
-    r = sudoku_write_html_page_with_solution(
-        difficulty_file(d),
-        css_href ? css_href : "style.css",
-        &puzzle,
-        &solution,
-        &theme,
-        d
-    );
-    return r == SUDOKU_OK;
+    //the "show me how" replay comes from the same grading pass
+    static SudokuTrace trace;
+    static char trace_b64[SUDOKU_TRACE_MAX_STEPS * 4 + 1];
+    SudokuGrade grade;
+    SudokuPageOptions options = {0};
+    options.compact = layout->compact;
+    options.theme_css = layout->theme_css;
+    if (sudoku_grade_trace(&puzzle, &solution, &grade, &trace) == SUDOKU_OK &&
+        sudoku_trace_to_base64(&trace, trace_b64, sizeof(trace_b64))) {
+        options.trace = trace_b64;
+    }
+
+    if (layout->tpl) {
+        r = sudoku_template_write_page(
+            layout->tpl, difficulty_file(d), css_href ? css_href : "style.css", &puzzle, &solution, &theme, d, &options
+        );
+    } else {
+        r = sudoku_write_html_page_ex(
+            difficulty_file(d),
+            css_href ? css_href : "style.css",
+            &puzzle,
+            &solution,
+            &theme,
+            d,
+            &options
+        );
+    }
+    if (r != SUDOKU_OK) return 0;
+    if (store_id >= 0) sudoku_store_mark_served(src->store, store_id);
+    if (src->seen && sudoku_seen_add(src->seen, hash, NULL) != SUDOKU_OK) {
+        fprintf(stderr, "Failed to update the seen set\n");
+    }
+    return 1;
 }
 
 int main(int argc, char** argv) {
@@ -149,16 +264,86 @@ int main(int argc, char** argv) {
     theme.page_title = base_title;
 
     int generate_all = 0;
-    if (argc >= 2 && strcmp(argv[1], "--all") == 0) generate_all = 1;
+    const char* masks_path = NULL;
+    const char* store_path = NULL;
+    const char* seen_path = NULL;
+    const char* template_path = NULL;
+    int compact = 0;
+    int theme_css = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--all") == 0) generate_all = 1;
+        else if (strcmp(argv[i], "--masks") == 0 && i + 1 < argc) masks_path = argv[++i];
+        else if (strcmp(argv[i], "--store") == 0 && i + 1 < argc) store_path = argv[++i];
+        else if (strcmp(argv[i], "--seen") == 0 && i + 1 < argc) seen_path = argv[++i];
+        else if (strcmp(argv[i], "--template") == 0 && i + 1 < argc) template_path = argv[++i];
+        else if (strcmp(argv[i], "--compact") == 0) compact = 1;
+        else if (strcmp(argv[i], "--theme-css") == 0) theme_css = 1;
+        else if (strcmp(argv[i], "--print-template") == 0) {
+            fputs(sudoku_template_default_text(), stdout);
+            return 0;
+        }
+    }
+
+    SudokuMaskLibrary masks;
+    sudoku_mask_library_init(&masks);
+    if (masks_path && sudoku_mask_library_load(&masks, masks_path) != SUDOKU_OK) {
+        fprintf(stderr, "Failed to read mask library %s\n", masks_path);
+        return 1;
+    }
+    PuzzleSources src = {0};
+    src.masks = masks.count > 0 ? &masks : NULL;
+
+    //store and seen set are closed by the os at exit, everything is already written
+    static SudokuStore store;
+    if (store_path) {
+        if (sudoku_store_open(&store, store_path) != SUDOKU_OK) {
+            fprintf(stderr, "Failed to open puzzle store %s\n", store_path);
+            return 1;
+        }
+        src.store = &store;
+    }
+    static SudokuSeenSet seen;
+    if (seen_path) {
+        if (sudoku_seen_open(&seen, seen_path) != SUDOKU_OK) {
+            fprintf(stderr, "Failed to open seen set %s\n", seen_path);
+            return 1;
+        }
+        src.seen = &seen;
+    }
+    //compiled once, every page only runs the op list
+    PageLayout layout = {0};
+    layout.compact = compact;
+    //one stylesheet for all pages (the theme is the same, only the titles differ)
+    static char theme_css_name[32];
+    if (theme_css) {
+        if (sudoku_write_theme_css(NULL, &theme, theme_css_name, sizeof(theme_css_name)) != SUDOKU_OK) {
+            fprintf(stderr, "Failed to write the theme stylesheet\n");
+            return 1;
+        }
+        layout.theme_css = theme_css_name;
+    }
+    static SudokuTemplate page_template;
+    if (template_path) {
+        SudokuResult tr = sudoku_template_load(&page_template, template_path);
+        if (tr != SUDOKU_OK) {
+            if (page_template.error_line > 0) {
+                fprintf(stderr, "Bad placeholder in template %s, line %d\n", template_path, page_template.error_line);
+            } else {
+                fprintf(stderr, "Failed to read template %s\n", template_path);
+            }
+            return 1;
+        }
+        layout.tpl = &page_template;
+    }
 
     if (generate_all) {
         if (!write_index_html(css_href, base_title, SUDOKU_DIFFICULTY_MEDIUM)) {
             fprintf(stderr, "Failed to write index.html\n");
             return 1;
         }
-        if (!generate_one(SUDOKU_DIFFICULTY_EASY, css_href, base_title, &theme) ||
-            !generate_one(SUDOKU_DIFFICULTY_MEDIUM, css_href, base_title, &theme) ||
-            !generate_one(SUDOKU_DIFFICULTY_HARD, css_href, base_title, &theme)) {
+        if (!generate_one(SUDOKU_DIFFICULTY_EASY, css_href, base_title, &theme, &src, &layout) ||
+            !generate_one(SUDOKU_DIFFICULTY_MEDIUM, css_href, base_title, &theme, &src, &layout) ||
+            !generate_one(SUDOKU_DIFFICULTY_HARD, css_href, base_title, &theme, &src, &layout)) {
             fprintf(stderr, "Failed to generate one of the pages\n");
             return 1;
         }
@@ -190,9 +375,9 @@ int main(int argc, char** argv) {
         return 1;
     }
 
-    if (!generate_one(SUDOKU_DIFFICULTY_EASY, css_href, base_title, &theme) ||
-        !generate_one(SUDOKU_DIFFICULTY_MEDIUM, css_href, base_title, &theme) ||
-        !generate_one(SUDOKU_DIFFICULTY_HARD, css_href, base_title, &theme)) {
+    if (!generate_one(SUDOKU_DIFFICULTY_EASY, css_href, base_title, &theme, &src, &layout) ||
+        !generate_one(SUDOKU_DIFFICULTY_MEDIUM, css_href, base_title, &theme, &src, &layout) ||
+        !generate_one(SUDOKU_DIFFICULTY_HARD, css_href, base_title, &theme, &src, &layout)) {
         fprintf(stderr, "Failed to generate sudoku pages\n");
         return 1;
     }
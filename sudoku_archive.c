@@ -0,0 +1,351 @@
+// sudoku_archive.c - compact puzzle archive that shares solution grids
+
+#include "sudoku_archive.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define ARCHIVE_VERSION 2
+#define ARCHIVE_HEADER 32
+
+//record layout (bits of the 16 bytes, little endian):
+//  0..80    clue mask
+//  81..87   transform id
+//  88..106  digit relabeling (rank of the permutation, 0..9!-1)
+//  107..127 grid id
+#define RELABELS 362880
+#define MAX_GRIDS (1 << 21)
+
+static const int perm3[6][3] = {
+    {0, 1, 2}, {0, 2, 1}, {1, 0, 2}, {1, 2, 0}, {2, 0, 1}, {2, 1, 0}
+};
+
+static void put_u32(unsigned char* p, uint32_t v) {
+    for (int i = 0; i < 4; ++i) p[i] = (unsigned char)((v >> (8 * i)) & 0xff);
+}
+
+static uint32_t get_u32(const unsigned char* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+//out = transform t of in (see sudoku_archive.h)
+static void apply_transform(const SudokuBoard* in, int t, SudokuBoard* out) {
+    int transpose = t / 36;
+    const int* bands = perm3[t / 6 % 6];
+    const int* stacks = perm3[t % 6];
+    for (int r = 0; r < 9; ++r) {
+        int sr = bands[r / 3] * 3 + r % 3;
+        for (int c = 0; c < 9; ++c) {
+            int sc = stacks[c / 3] * 3 + c % 3;
+            out->cell[r][c] = transpose ? in->cell[sc][sr] : in->cell[sr][sc];
+        }
+    }
+}
+
+//relabels b in place so its first row reads 1..9
+static void relabel_first_row(SudokuBoard* b) {
+    int map[10];
+    for (int c = 0; c < 9; ++c) map[b->cell[0][c]] = c + 1;
+    for (int i = 0; i < 81; ++i) b->cell[i / 9][i % 9] = map[b->cell[i / 9][i % 9]];
+}
+
+//rank of the permutation map[1..9] (of 1..9) and back (lehmer code)
+static uint32_t perm_rank(const int* map) {
+    uint32_t rank = 0;
+    for (int i = 1; i <= 9; ++i) {
+        int smaller = 0;
+        for (int j = i + 1; j <= 9; ++j) {
+            if (map[j] < map[i]) ++smaller;
+        }
+        rank = rank * (uint32_t)(10 - i) + (uint32_t)smaller;
+    }
+    return rank;
+}
+
+static void perm_unrank(uint32_t rank, int* map) {
+    int digits[10];
+    for (int i = 9; i >= 1; --i) {
+        digits[i] = (int)(rank % (uint32_t)(10 - i));
+        rank /= (uint32_t)(10 - i);
+    }
+    int used = 0;
+    for (int i = 1; i <= 9; ++i) {
+        int k = digits[i];
+        for (int v = 1; v <= 9; ++v) {
+            if (used & (1 << v)) continue;
+            if (k-- == 0) {
+                map[i] = v;
+                used |= 1 << v;
+                break;
+            }
+        }
+    }
+}
+
+//a stored grid has 1..9 in its first row (relabeling puts it there), and the last column and
+//last row follow from the others (each row / column adds up to 45), so only rows 1..7 x
+//columns 0..7 are kept: 56 cells, two per byte, low nibble first
+static void pack_grid(const SudokuBoard* b, unsigned char* out) {
+    memset(out, 0, SUDOKU_ARCHIVE_GRID_SIZE);
+    for (int i = 0; i < 56; ++i) {
+        int v = b->cell[1 + i / 8][i % 8] & 0x0f;
+        out[i / 2] |= (unsigned char)((i & 1) ? v << 4 : v);
+    }
+}
+
+//0 if the cells do not make a grid of digits 1..9 (a damaged file)
+static int unpack_grid(const unsigned char* in, SudokuBoard* out) {
+    for (int c = 0; c < 9; ++c) out->cell[0][c] = c + 1;
+    for (int i = 0; i < 56; ++i) {
+        int b = in[i / 2];
+        out->cell[1 + i / 8][i % 8] = (i & 1) ? b >> 4 : b & 0x0f;
+    }
+    for (int r = 1; r < 8; ++r) {
+        int sum = 0;
+        for (int c = 0; c < 8; ++c) sum += out->cell[r][c];
+        out->cell[r][8] = 45 - sum;
+    }
+    for (int c = 0; c < 9; ++c) {
+        int sum = 0;
+        for (int r = 0; r < 8; ++r) sum += out->cell[r][c];
+        out->cell[8][c] = 45 - sum;
+    }
+    for (int i = 0; i < 81; ++i) {
+        int v = out->cell[i / 9][i % 9];
+        if (v < 1 || v > 9) return 0;
+    }
+    return 1;
+}
+
+static uint32_t hash_grid(const unsigned char* g) {
+    //fnv-1a
+    uint32_t h = 2166136261u;
+    for (int i = 0; i < SUDOKU_ARCHIVE_GRID_SIZE; ++i) {
+        h ^= g[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static int board_less(const SudokuBoard* a, const SudokuBoard* b) {
+    for (int i = 0; i < 81; ++i) {
+        int x = a->cell[i / 9][i % 9], y = b->cell[i / 9][i % 9];
+        if (x != y) return x < y;
+    }
+    return 0;
+}
+
+void sudoku_archive_writer_init(SudokuArchiveWriter* w) {
+    if (!w) return;
+    memset(w, 0, sizeof(*w));
+}
+
+void sudoku_archive_writer_free(SudokuArchiveWriter* w) {
+    if (!w) return;
+    free(w->grids);
+    free(w->records);
+    free(w->table);
+    memset(w, 0, sizeof(*w));
+}
+
+//slot of grid g in the lookup table: its id, or an empty slot (-1)
+static int* find_grid(const SudokuArchiveWriter* w, const unsigned char* g) {
+    int mask = w->table_cap - 1;
+    int i = (int)(hash_grid(g) & (uint32_t)mask);
+    while (w->table[i] >= 0) {
+        if (memcmp(w->grids + (size_t)w->table[i] * SUDOKU_ARCHIVE_GRID_SIZE, g, SUDOKU_ARCHIVE_GRID_SIZE) == 0) break;
+        i = (i + 1) & mask;
+    }
+    return &w->table[i];
+}
+
+static SudokuResult grow_table(SudokuArchiveWriter* w) {
+    int ncap = w->table_cap ? w->table_cap * 2 : 1024;
+    int* nt = (int*)malloc((size_t)ncap * sizeof(int));
+    if (!nt) return SUDOKU_ERR_NO_MEMORY;
+    for (int i = 0; i < ncap; ++i) nt[i] = -1;
+    free(w->table);
+    w->table = nt;
+    w->table_cap = ncap;
+    for (int id = 0; id < w->grid_count; ++id) {
+        *find_grid(w, w->grids + (size_t)id * SUDOKU_ARCHIVE_GRID_SIZE) = id;
+    }
+    return SUDOKU_OK;
+}
+
+//id of grid g, added if it is new; -1 = out of memory, -2 = the grid id field is full
+static int grid_id(SudokuArchiveWriter* w, const unsigned char* g) {
+    if (w->grid_count * 2 >= w->table_cap && grow_table(w) != SUDOKU_OK) return -1;
+    int* slot = find_grid(w, g);
+    if (*slot >= 0) return *slot;
+    if (w->grid_count == MAX_GRIDS) return -2;
+
+    if (w->grid_count == w->grid_cap) {
+        int ncap = w->grid_cap ? w->grid_cap * 2 : 256;
+        unsigned char* ng = (unsigned char*)realloc(w->grids, (size_t)ncap * SUDOKU_ARCHIVE_GRID_SIZE);
+        if (!ng) return -1;
+        w->grids = ng;
+        w->grid_cap = ncap;
+    }
+    memcpy(w->grids + (size_t)w->grid_count * SUDOKU_ARCHIVE_GRID_SIZE, g, SUDOKU_ARCHIVE_GRID_SIZE);
+    *slot = w->grid_count;
+    return w->grid_count++;
+}
+
+SudokuResult sudoku_archive_add(SudokuArchiveWriter* w, const SudokuBoard* puzzle, const SudokuBoard* solution) {
+    if (!w || !puzzle || !solution) return SUDOKU_ERR_INVALID_ARG;
+    //a full valid grid (the stored form leaves out cells that only follow from that)
+    if (!sudoku_is_valid_partial(solution)) return SUDOKU_ERR_INVALID_ARG;
+    for (int i = 0; i < 81; ++i) {
+        int s = solution->cell[i / 9][i % 9];
+        int p = puzzle->cell[i / 9][i % 9];
+        if (s < 1 || s > 9 || (p != 0 && p != s)) return SUDOKU_ERR_INVALID_ARG;
+    }
+
+    //the smallest of the 72 variants (each relabeled to 1..9 in its first row) is the stored
+    //grid, so all variants and relabelings find the same one
+    SudokuBoard grid, tmp;
+    apply_transform(solution, 0, &grid);
+    relabel_first_row(&grid);
+    for (int t = 1; t < SUDOKU_ARCHIVE_TRANSFORMS; ++t) {
+        apply_transform(solution, t, &tmp);
+        relabel_first_row(&tmp);
+        if (board_less(&tmp, &grid)) grid = tmp;
+    }
+    //the transform + relabeling that turn the grid back into this solution
+    int back = -1;
+    int map[10];
+    for (int t = 0; t < SUDOKU_ARCHIVE_TRANSFORMS && back < 0; ++t) {
+        apply_transform(&grid, t, &tmp);
+        for (int c = 0; c < 9; ++c) map[tmp.cell[0][c]] = solution->cell[0][c];
+        int same = 1;
+        for (int i = 0; i < 81 && same; ++i) same = map[tmp.cell[i / 9][i % 9]] == solution->cell[i / 9][i % 9];
+        if (same) back = t;
+    }
+    if (back < 0) return SUDOKU_ERR_INVALID_ARG;
+
+    unsigned char packed[SUDOKU_ARCHIVE_GRID_SIZE];
+    pack_grid(&grid, packed);
+    int id = grid_id(w, packed);
+    if (id == -2) return SUDOKU_ERR_INVALID_ARG;
+    if (id < 0) return SUDOKU_ERR_NO_MEMORY;
+
+    if (w->puzzle_count == w->puzzle_cap) {
+        int ncap = w->puzzle_cap ? w->puzzle_cap * 2 : 1024;
+        unsigned char* nr = (unsigned char*)realloc(w->records, (size_t)ncap * SUDOKU_ARCHIVE_RECORD_SIZE);
+        if (!nr) return SUDOKU_ERR_NO_MEMORY;
+        w->records = nr;
+        w->puzzle_cap = ncap;
+    }
+    unsigned char* rec = w->records + (size_t)w->puzzle_count * SUDOKU_ARCHIVE_RECORD_SIZE;
+    memset(rec, 0, SUDOKU_ARCHIVE_RECORD_SIZE);
+    for (int i = 0; i < 81; ++i) {
+        if (puzzle->cell[i / 9][i % 9] != 0) rec[i / 8] |= (unsigned char)(1 << (i % 8));
+    }
+    rec[10] |= (unsigned char)(back << 1);
+    uint64_t tail = (uint64_t)perm_rank(map) | ((uint64_t)id << 19);
+    for (int i = 0; i < 5; ++i) rec[11 + i] = (unsigned char)((tail >> (8 * i)) & 0xff);
+    ++w->puzzle_count;
+    return SUDOKU_OK;
+}
+
+SudokuResult sudoku_archive_write(const SudokuArchiveWriter* w, const char* path) {
+    if (!w || !path) return SUDOKU_ERR_INVALID_ARG;
+
+    size_t grids_bytes = (size_t)w->grid_count * SUDOKU_ARCHIVE_GRID_SIZE;
+    size_t records_bytes = (size_t)w->puzzle_count * SUDOKU_ARCHIVE_RECORD_SIZE;
+    unsigned char h[ARCHIVE_HEADER];
+    memset(h, 0, sizeof(h));
+    memcpy(h, "SDKA", 4);
+    put_u32(h + 4, ARCHIVE_VERSION);
+    put_u32(h + 8, (uint32_t)w->grid_count);
+    put_u32(h + 12, (uint32_t)w->puzzle_count);
+    put_u32(h + 16, ARCHIVE_HEADER);
+    put_u32(h + 20, (uint32_t)(ARCHIVE_HEADER + grids_bytes));
+
+    //temp file + rename like every other writer, so a reader never sees half an archive
+    char tmp[1040];
+    if (!sudoku_temp_path(path, tmp, sizeof(tmp))) return SUDOKU_ERR_INVALID_ARG;
+    FILE* f = fopen(tmp, "wb");
+    if (!f) return SUDOKU_ERR_IO;
+    SudokuResult res = SUDOKU_OK;
+    if (fwrite(h, 1, sizeof(h), f) != sizeof(h) ||
+        (grids_bytes && fwrite(w->grids, 1, grids_bytes, f) != grids_bytes) ||
+        (records_bytes && fwrite(w->records, 1, records_bytes, f) != records_bytes)) {
+        res = SUDOKU_ERR_IO;
+    }
+    if (fclose(f) != 0) res = SUDOKU_ERR_IO;
+    if (res != SUDOKU_OK) {
+        remove(tmp);
+        return res;
+    }
+    return sudoku_replace_file(tmp, path);
+}
+
+SudokuResult sudoku_archive_open(SudokuArchive* archive, const char* path) {
+    if (!archive || !path) return SUDOKU_ERR_INVALID_ARG;
+    memset(archive, 0, sizeof(*archive));
+
+    FILE* f = fopen(path, "rb");
+    if (!f) return SUDOKU_ERR_IO;
+    long size = -1;
+    if (fseek(f, 0, SEEK_END) == 0) size = ftell(f);
+    if (size < ARCHIVE_HEADER || fseek(f, 0, SEEK_SET) != 0) {
+        fclose(f);
+        return SUDOKU_ERR_IO;
+    }
+    unsigned char* data = (unsigned char*)malloc((size_t)size);
+    if (!data) {
+        fclose(f);
+        return SUDOKU_ERR_NO_MEMORY;
+    }
+    size_t got = fread(data, 1, (size_t)size, f);
+    fclose(f);
+
+    size_t grids = get_u32(data + 8);
+    size_t puzzles = get_u32(data + 12);
+    size_t grids_off = get_u32(data + 16);
+    size_t records_off = get_u32(data + 20);
+    if (got != (size_t)size || memcmp(data, "SDKA", 4) != 0 || get_u32(data + 4) != ARCHIVE_VERSION ||
+        grids_off + grids * SUDOKU_ARCHIVE_GRID_SIZE > records_off ||
+        records_off + puzzles * SUDOKU_ARCHIVE_RECORD_SIZE > (size_t)size) {
+        free(data);
+        return SUDOKU_ERR_IO;
+    }
+    archive->data = data;
+    archive->grid_count = (int)grids;
+    archive->puzzle_count = (int)puzzles;
+    archive->grids = data + grids_off;
+    archive->records = data + records_off;
+    return SUDOKU_OK;
+}
+
+void sudoku_archive_close(SudokuArchive* archive) {
+    if (!archive) return;
+    free(archive->data);
+    memset(archive, 0, sizeof(*archive));
+}
+
+SudokuResult sudoku_archive_get(const SudokuArchive* archive, int index, SudokuBoard* out_puzzle, SudokuBoard* out_solution) {
+    if (!archive || !out_puzzle || index < 0 || index >= archive->puzzle_count) return SUDOKU_ERR_INVALID_ARG;
+    const unsigned char* rec = archive->records + (size_t)index * SUDOKU_ARCHIVE_RECORD_SIZE;
+    int t = rec[10] >> 1;
+    uint64_t tail = 0;
+    for (int i = 0; i < 5; ++i) tail |= (uint64_t)rec[11 + i] << (8 * i);
+    uint32_t relabel = (uint32_t)(tail & ((1u << 19) - 1));
+    uint32_t id = (uint32_t)(tail >> 19);
+    if (id >= (uint32_t)archive->grid_count || t >= SUDOKU_ARCHIVE_TRANSFORMS || relabel >= RELABELS) return SUDOKU_ERR_IO;
+
+    SudokuBoard grid, solution;
+    if (!unpack_grid(archive->grids + (size_t)id * SUDOKU_ARCHIVE_GRID_SIZE, &grid)) return SUDOKU_ERR_IO;
+    apply_transform(&grid, t, &solution);
+    int map[10];
+    perm_unrank(relabel, map);
+    for (int i = 0; i < 81; ++i) solution.cell[i / 9][i % 9] = map[solution.cell[i / 9][i % 9]];
+    for (int i = 0; i < 81; ++i) {
+        int keep = (rec[i / 8] >> (i % 8)) & 1;
+        out_puzzle->cell[i / 9][i % 9] = keep ? solution.cell[i / 9][i % 9] : 0;
+    }
+    if (out_solution) *out_solution = solution;
+    return SUDOKU_OK;
+}
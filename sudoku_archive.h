@@ -0,0 +1,75 @@
+// sudoku_archive.h - compact puzzle archive that shares solution grids
+
+//many puzzles have the same solution grid up to symmetry (several diggings of one grid, or a grid
+//that is only a band/stack swap, transpose or digit relabeling of another), so the archive keeps
+//every grid once (28 bytes) and stores each puzzle as 16 bytes:
+//  clue mask (81 bits), transform id (7 bits), digit relabeling (19 bits), grid id (21 bits)
+//puzzle + solution as text is 164 bytes a line; the archive is 16 bytes + a share of a grid, so
+//it depends on how many puzzles share a grid: 10 per grid is ~19 bytes a puzzle (8.7x smaller),
+//while puzzles that each have their own grid (eg. straight from sudoku_generate_puzzle, random
+//grids practically never repeat) are 44 bytes a puzzle (3.7x)
+
+//transform id 0..71: transpose (t / 36), band order (t / 6 % 6), stack order (t % 6)
+//the solution of a record is relabel(transform(grid)); the mask says which of its cells are clues
+//relabeling is the rank of the digit permutation (0..9!-1); stored grids are relabeled to have
+//1..9 in the first row, which is why that row (and the last row and column, which follow from the
+//rest) is not stored; an archive holds up to 2^21 different grids
+
+//file layout (little endian):
+//  header 32 bytes: "SDKA", version, grid count, puzzle count, grids offset, records offset, 0, 0
+//  grids   grid count * 28 bytes (rows 1..7 x columns 0..7, two cells per byte, low nibble first)
+//  records puzzle count * 16 bytes
+
+#ifndef SUDOKU_ARCHIVE_H
+#define SUDOKU_ARCHIVE_H
+
+#include "sudoku_module.h"
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SUDOKU_ARCHIVE_GRID_SIZE 28
+#define SUDOKU_ARCHIVE_RECORD_SIZE 16
+#define SUDOKU_ARCHIVE_TRANSFORMS 72
+
+typedef struct SudokuArchiveWriter {
+    unsigned char* grids;     // grid_count * SUDOKU_ARCHIVE_GRID_SIZE
+    int grid_count, grid_cap;
+    unsigned char* records;   // puzzle_count * SUDOKU_ARCHIVE_RECORD_SIZE
+    int puzzle_count, puzzle_cap;
+    int* table;               // grid lookup, open addressing, -1 = empty
+    int table_cap;
+} SudokuArchiveWriter;
+
+typedef struct SudokuArchive {
+    unsigned char* data;      // the whole file
+    int grid_count;
+    int puzzle_count;
+    const unsigned char* grids;
+    const unsigned char* records;
+} SudokuArchive;
+
+void sudoku_archive_writer_init(SudokuArchiveWriter* w);
+void sudoku_archive_writer_free(SudokuArchiveWriter* w);
+
+//adds a puzzle with its (full) solution; the grid is shared with an earlier puzzle if the
+//solution is one of the 72 transforms of a grid already in the archive, relabeled or not
+//SUDOKU_ERR_INVALID_ARG for a bad solution, or a new grid when 2^21 are already in
+SudokuResult sudoku_archive_add(SudokuArchiveWriter* w, const SudokuBoard* puzzle, const SudokuBoard* solution);
+
+SudokuResult sudoku_archive_write(const SudokuArchiveWriter* w, const char* path);
+
+SudokuResult sudoku_archive_open(SudokuArchive* archive, const char* path);
+void sudoku_archive_close(SudokuArchive* archive);
+
+//puzzle number `index` (in the order they were added); solution is optional
+SudokuResult sudoku_archive_get(const SudokuArchive* archive, int index, SudokuBoard* out_puzzle, SudokuBoard* out_solution);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
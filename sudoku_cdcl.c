@@ -0,0 +1,367 @@
+// sudoku_cdcl.c - small cdcl sat solver with a direct sudoku encoding
+
+//encoding: one boolean variable per (row, col, value) = 729 variables
+//clauses: every cell/row/col/box has each value at least once and at most once,
+//givens from the board become unit clauses
+//solver: two watched literals, 1-uip conflict analysis (learns a nogood clause
+//for every conflict), non-chronological backjumping, activity based decisions
+//with phase saving and simple geometric restarts
+//no clause deletion: for one 9x9 board the learned clauses stay small
+
+#include "sudoku_cdcl.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define NVARS 729
+#define NLITS (2 * NVARS)
+
+//literal = 2 * var + sign (sign 1 = negated)
+static int pos_lit(int var) { return 2 * var; }
+static int neg_lit(int var) { return 2 * var + 1; }
+static int lit_var(int lit) { return lit >> 1; }
+
+static int var_of(int r, int c, int v) {
+    return r * 81 + c * 9 + (v - 1);
+}
+
+typedef struct IntVec {
+    int* data;
+    int size;
+    int cap;
+} IntVec;
+
+static int vec_push(IntVec* v, int x) {
+    if (v->size == v->cap) {
+        int ncap = v->cap ? v->cap * 2 : 8;
+        int* nd = (int*)realloc(v->data, (size_t)ncap * sizeof(int));
+        if (!nd) return 0;
+        v->data = nd;
+        v->cap = ncap;
+    }
+    v->data[v->size++] = x;
+    return 1;
+}
+
+typedef struct Cdcl {
+    IntVec lits;          // all clause literals, back to back
+    IntVec start;         // clause i starts at lits.data[start.data[i]]
+    IntVec len;           // and has len.data[i] literals
+    IntVec watches[NLITS]; // watches[l] = clauses that watch literal l
+
+    signed char value[NVARS]; // -1 unassigned, 0 false, 1 true
+    int level[NVARS];
+    int reason[NVARS];        // clause that implied the var, -1 for decisions
+    unsigned char phase[NVARS];
+    unsigned char seen[NVARS];
+    double activity[NVARS];
+    double bump;
+
+    int trail[NVARS];
+    int trail_size;
+    int trail_lim[NVARS + 2]; // trail_lim[l] = where decision level l starts
+    int levels;
+    int qhead;
+
+    IntVec learnt;
+    int oom;
+} Cdcl;
+
+static int lit_value(const Cdcl* s, int lit) {
+    int v = s->value[lit_var(lit)];
+    if (v < 0) return -1;
+    return (lit & 1) ? !v : v;
+}
+
+static void enqueue(Cdcl* s, int lit, int reason) {
+    int var = lit_var(lit);
+    s->value[var] = (signed char)!(lit & 1);
+    s->level[var] = s->levels;
+    s->reason[var] = reason;
+    s->trail[s->trail_size++] = lit;
+}
+
+//stores a clause (n >= 2) and watches its first two literals
+static int store_clause(Cdcl* s, const int* lits, int n) {
+    int id = s->start.size;
+    if (!vec_push(&s->start, s->lits.size) || !vec_push(&s->len, n)) return -1;
+    for (int i = 0; i < n; ++i) {
+        if (!vec_push(&s->lits, lits[i])) return -1;
+    }
+    if (!vec_push(&s->watches[lits[0]], id) || !vec_push(&s->watches[lits[1]], id)) return -1;
+    return id;
+}
+
+//level 0 clause from the encoding; returns 0 if it is already violated
+static int add_clause(Cdcl* s, const int* lits, int n) {
+    if (n == 1) {
+        int val = lit_value(s, lits[0]);
+        if (val == 0) return 0;
+        if (val < 0) enqueue(s, lits[0], -1);
+        return 1;
+    }
+    if (store_clause(s, lits, n) < 0) s->oom = 1;
+    return 1;
+}
+
+//"exactly one of these 9 vars": one long clause + 36 binary ones
+static void add_exactly_one(Cdcl* s, const int* vars) {
+    int lits[9];
+    for (int i = 0; i < 9; ++i) lits[i] = pos_lit(vars[i]);
+    add_clause(s, lits, 9);
+    for (int i = 0; i < 9; ++i) {
+        for (int j = i + 1; j < 9; ++j) {
+            int pair[2];
+            pair[0] = neg_lit(vars[i]);
+            pair[1] = neg_lit(vars[j]);
+            add_clause(s, pair, 2);
+        }
+    }
+}
+
+static int encode_board(Cdcl* s, const SudokuBoard* b) {
+    int vars[9];
+
+    //givens first, so the encoding clauses see them as level 0 facts
+    for (int r = 0; r < 9; ++r) {
+        for (int c = 0; c < 9; ++c) {
+            int v = b->cell[r][c];
+            if (v == 0) continue;
+            int unit = pos_lit(var_of(r, c, v));
+            if (!add_clause(s, &unit, 1)) return 0;
+        }
+    }
+
+    for (int r = 0; r < 9; ++r) {
+        for (int c = 0; c < 9; ++c) {
+            for (int v = 1; v <= 9; ++v) vars[v - 1] = var_of(r, c, v);
+            add_exactly_one(s, vars);
+        }
+    }
+    for (int v = 1; v <= 9; ++v) {
+        for (int i = 0; i < 9; ++i) {
+            for (int j = 0; j < 9; ++j) vars[j] = var_of(i, j, v);
+            add_exactly_one(s, vars);
+            for (int j = 0; j < 9; ++j) vars[j] = var_of(j, i, v);
+            add_exactly_one(s, vars);
+            int br = (i / 3) * 3, bc = (i % 3) * 3;
+            for (int j = 0; j < 9; ++j) vars[j] = var_of(br + j / 3, bc + j % 3, v);
+            add_exactly_one(s, vars);
+        }
+    }
+    return !s->oom;
+}
+
+//returns the conflicting clause, or -1 if everything propagated fine
+static int propagate(Cdcl* s) {
+    while (s->qhead < s->trail_size) {
+        int false_lit = s->trail[s->qhead++] ^ 1;
+        IntVec* ws = &s->watches[false_lit];
+        int i = 0, j = 0;
+
+        while (i < ws->size) {
+            int ci = ws->data[i++];
+            int* c = s->lits.data + s->start.data[ci];
+            int n = s->len.data[ci];
+
+            //keep the false literal in slot 1
+            if (c[0] == false_lit) {
+                c[0] = c[1];
+                c[1] = false_lit;
+            }
+            if (lit_value(s, c[0]) == 1) {
+                ws->data[j++] = ci;
+                continue;
+            }
+
+            //look for another literal to watch
+            int moved = 0;
+            for (int k = 2; k < n; ++k) {
+                if (lit_value(s, c[k]) != 0) {
+                    c[1] = c[k];
+                    c[k] = false_lit;
+                    if (!vec_push(&s->watches[c[1]], ci)) s->oom = 1;
+                    moved = 1;
+                    break;
+                }
+            }
+            if (moved) continue;
+
+            ws->data[j++] = ci;
+            if (lit_value(s, c[0]) == 0) {
+                while (i < ws->size) ws->data[j++] = ws->data[i++];
+                ws->size = j;
+                s->qhead = s->trail_size;
+                return ci;
+            }
+            enqueue(s, c[0], ci);
+        }
+        ws->size = j;
+    }
+    return -1;
+}
+
+static void bump_var(Cdcl* s, int var) {
+    s->activity[var] += s->bump;
+    if (s->activity[var] > 1e100) {
+        for (int i = 0; i < NVARS; ++i) s->activity[i] *= 1e-100;
+        s->bump *= 1e-100;
+    }
+}
+
+//1-uip: walk the trail back from the conflict until only one literal of the
+//current level is left; the result (in s->learnt) is the clause we learn
+//returns the level to jump back to
+static int analyze(Cdcl* s, int confl) {
+    int path = 0;
+    int p = -1;
+    int index = s->trail_size - 1;
+
+    s->learnt.size = 0;
+    if (!vec_push(&s->learnt, 0)) s->oom = 1; // slot for the uip literal
+
+    do {
+        const int* c = s->lits.data + s->start.data[confl];
+        int n = s->len.data[confl];
+        for (int k = (p < 0) ? 0 : 1; k < n; ++k) {
+            int var = lit_var(c[k]);
+            if (s->seen[var] || s->level[var] == 0) continue;
+            s->seen[var] = 1;
+            bump_var(s, var);
+            if (s->level[var] == s->levels) {
+                ++path;
+            } else if (!vec_push(&s->learnt, c[k])) {
+                s->oom = 1;
+            }
+        }
+
+        while (!s->seen[lit_var(s->trail[index])]) --index;
+        p = s->trail[index--];
+        confl = s->reason[lit_var(p)];
+        s->seen[lit_var(p)] = 0;
+        --path;
+    } while (path > 0);
+
+    s->learnt.data[0] = p ^ 1;
+
+    //the highest other level goes to slot 1, so it is watched after the jump
+    int back = 0;
+    for (int k = 1; k < s->learnt.size; ++k) {
+        int lv = s->level[lit_var(s->learnt.data[k])];
+        if (lv > back) {
+            back = lv;
+            int tmp = s->learnt.data[1];
+            s->learnt.data[1] = s->learnt.data[k];
+            s->learnt.data[k] = tmp;
+        }
+    }
+    for (int k = 1; k < s->learnt.size; ++k) s->seen[lit_var(s->learnt.data[k])] = 0;
+    return back;
+}
+
+static void backtrack(Cdcl* s, int lvl) {
+    if (s->levels <= lvl) return;
+    for (int i = s->trail_size - 1; i >= s->trail_lim[lvl + 1]; --i) {
+        int var = lit_var(s->trail[i]);
+        s->phase[var] = (unsigned char)s->value[var];
+        s->value[var] = -1;
+    }
+    s->trail_size = s->trail_lim[lvl + 1];
+    s->qhead = s->trail_size;
+    s->levels = lvl;
+}
+
+static int pick_branch_lit(const Cdcl* s) {
+    int best = -1;
+    for (int v = 0; v < NVARS; ++v) {
+        if (s->value[v] >= 0) continue;
+        if (best < 0 || s->activity[v] > s->activity[best]) best = v;
+    }
+    if (best < 0) return -1;
+    return s->phase[best] ? pos_lit(best) : neg_lit(best);
+}
+
+static SudokuResult search(Cdcl* s) {
+    int conflicts = 0;
+    int restart_at = 100;
+
+    for (;;) {
+        int confl = propagate(s);
+        if (s->oom) return SUDOKU_ERR_NO_MEMORY;
+
+        if (confl >= 0) {
+            if (s->levels == 0) return SUDOKU_ERR_UNSOLVABLE;
+            int back = analyze(s, confl);
+            if (s->oom) return SUDOKU_ERR_NO_MEMORY;
+            backtrack(s, back);
+
+            if (s->learnt.size == 1) {
+                enqueue(s, s->learnt.data[0], -1);
+            } else {
+                int id = store_clause(s, s->learnt.data, s->learnt.size);
+                if (id < 0) return SUDOKU_ERR_NO_MEMORY;
+                enqueue(s, s->learnt.data[0], id);
+            }
+            s->bump *= 1.0 / 0.95;
+            ++conflicts;
+            continue;
+        }
+
+        if (conflicts >= restart_at) {
+            backtrack(s, 0);
+            conflicts = 0;
+            restart_at += restart_at / 2;
+            continue;
+        }
+
+        int lit = pick_branch_lit(s);
+        if (lit < 0) return SUDOKU_OK; // every var assigned, no conflict
+        ++s->levels;
+        s->trail_lim[s->levels] = s->trail_size;
+        enqueue(s, lit, -1);
+    }
+}
+
+static void cdcl_free(Cdcl* s) {
+    free(s->lits.data);
+    free(s->start.data);
+    free(s->len.data);
+    free(s->learnt.data);
+    for (int i = 0; i < NLITS; ++i) free(s->watches[i].data);
+    free(s);
+}
+
+SudokuResult sudoku_cdcl_solve(SudokuBoard* in_out_board) {
+    if (!in_out_board) return SUDOKU_ERR_INVALID_ARG;
+
+    Cdcl* s = (Cdcl*)calloc(1, sizeof(Cdcl));
+    if (!s) return SUDOKU_ERR_NO_MEMORY;
+
+    memset(s->value, -1, sizeof(s->value));
+    s->bump = 1.0;
+    for (int v = 0; v < NVARS; ++v) {
+        //tiny random start activity = different (but still valid) solutions per seed
+        s->activity[v] = (double)rand() / ((double)RAND_MAX + 1.0) * 1e-3;
+        s->phase[v] = 1; // try "cell has this value" first
+    }
+
+    SudokuResult res;
+    if (!encode_board(s, in_out_board)) {
+        res = s->oom ? SUDOKU_ERR_NO_MEMORY : SUDOKU_ERR_UNSOLVABLE;
+    } else {
+        res = search(s);
+    }
+
+    if (res == SUDOKU_OK) {
+        for (int r = 0; r < 9; ++r) {
+            for (int c = 0; c < 9; ++c) {
+                for (int v = 1; v <= 9; ++v) {
+                    if (s->value[var_of(r, c, v)] == 1) in_out_board->cell[r][c] = v;
+                }
+            }
+        }
+    }
+
+    cdcl_free(s);
+    return res;
+}
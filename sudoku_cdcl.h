@@ -0,0 +1,23 @@
+// sudoku_cdcl.h - clause learning (cdcl) engine, used by sudoku_module.c
+
+//not meant to be called directly: pick it with sudoku_set_engine(SUDOKU_ENGINE_CDCL)
+//and keep using sudoku_solve() / sudoku_generate_solution()
+
+#ifndef SUDOKU_CDCL_H
+#define SUDOKU_CDCL_H
+
+#include "sudoku_module.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//solves in-place (0 = empty); caller checks that the givens don't break the rules
+//returns SUDOKU_OK, SUDOKU_ERR_UNSOLVABLE or SUDOKU_ERR_NO_MEMORY
+SudokuResult sudoku_cdcl_solve(SudokuBoard* in_out_board);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,794 @@
+// sudoku_db.c - build and query the binary puzzle store
+
+//clock_gettime / nanosleep (site and bench timing) are posix, not c99
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200112L
+#endif
+
+// goal: find puzzles by grade, clue count and techniques without scanning text files
+//build: grades every unique puzzle of a text file and writes the store with its indexes
+//ingest: the same for long runs, adding to an existing store through a crash safe log
+//        (sudoku_log.h); run it again after a crash and it goes on where the log ends
+//query: prints random matching puzzles (or only the number of matches)
+//pack / unpack: compact archive of puzzles + solutions that shares solution grids (sudoku_archive.h)
+//site: a playable page for every puzzle of an archive, plus paginated index pages, sitemaps
+//      and a json manifest written in the same pass (sudoku_site.h); --thumbs adds a png
+//      preview per page (sudoku_thumb.h), rendered in batches on --threads threads
+//bench: open loop load on the page pipeline (graded pages, cached renders, thumbnails) at a
+//       fixed arrival rate, with latency percentiles measured from the planned start times
+
+// Build:
+//   gcc -std=c99 -O2 -Wall -Wextra -pedantic -pthread sudoku_module.c sudoku_cdcl.c sudoku_grade.c sudoku_store.c sudoku_log.c sudoku_archive.c sudoku_template.c sudoku_site.c sudoku_thumb.c sudoku_db.c -o sudoku_db
+
+// Run:
+//   ./sudoku_db build mined.txt puzzles.sdb
+//   ./sudoku_db ingest mined.txt puzzles.sdb --batch 256 --compact-every 100
+//   ./sudoku_db query puzzles.sdb --difficulty hard --tech x-wing --clues 23-25 --unserved --mark
+//   ./sudoku_db query puzzles.sdb --score 300-9999 --count
+//   ./sudoku_db pack puzzles_and_solutions.txt archive.sda
+//   ./sudoku_db unpack archive.sda > puzzles_and_solutions.txt
+//   ./sudoku_db site archive.sda site/ --base-url https://example.com/sudoku/ --per-page 200 --compact --shard
+//   ./sudoku_db site archive.sda site/ --base-url https://example.com/sudoku/ --thumbs --thumb-size 360 --threads 4
+//   ./sudoku_db bench archive.sda --rate 500 --seconds 10 --mix 20,75,5
+
+//input: one puzzle per line, 81 chars, '0' or '.' = empty (anything after is ignored,
+//so miner result files work as they are); pack also reads "<puzzle> <solution>" lines
+//and only solves puzzles without a solution
+
+#include "sudoku_module.h"
+#include "sudoku_grade.h"
+#include "sudoku_store.h"
+#include "sudoku_log.h"
+#include "sudoku_archive.h"
+#include "sudoku_template.h"
+#include "sudoku_site.h"
+#include "sudoku_thumb.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <windows.h> // Sleep
+#endif
+
+static int parse_range(const char* s, int* lo, int* hi) {
+    if (sscanf(s, "%d-%d", lo, hi) == 2) return 1;
+    if (sscanf(s, "%d", lo) == 1) {
+        *hi = *lo;
+        return 1;
+    }
+    return 0;
+}
+
+static int parse_technique(const char* s, SudokuTechnique* out) {
+    for (int t = 0; t < SUDOKU_TECH_COUNT; ++t) {
+        if (strcmp(s, sudoku_technique_name((SudokuTechnique)t)) == 0) {
+            *out = (SudokuTechnique)t;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int build(const char* in_path, const char* out_path) {
+    FILE* f = fopen(in_path, "r");
+    if (!f) {
+        fprintf(stderr, "Failed to open %s\n", in_path);
+        return 1;
+    }
+
+    SudokuStoreEntry* entries = NULL;
+    int count = 0, cap = 0, skipped = 0;
+    char line[256];
+    while (fgets(line, sizeof(line), f)) {
+        SudokuStoreEntry e;
+        e.served = 0;
+        if (!sudoku_board_from_string(line, &e.puzzle)) continue;
+        if (sudoku_count_solutions(&e.puzzle, 2, NULL) != 1 || sudoku_grade(&e.puzzle, &e.grade) != SUDOKU_OK) {
+            ++skipped;
+            continue;
+        }
+        if (count == cap) {
+            int ncap = cap ? cap * 2 : 1024;
+            SudokuStoreEntry* ne = (SudokuStoreEntry*)realloc(entries, (size_t)ncap * sizeof(SudokuStoreEntry));
+            if (!ne) {
+                fclose(f);
+                free(entries);
+                fprintf(stderr, "Out of memory\n");
+                return 1;
+            }
+            entries = ne;
+            cap = ncap;
+        }
+        entries[count++] = e;
+    }
+    fclose(f);
+
+    SudokuResult r = sudoku_store_write(out_path, entries, count);
+    free(entries);
+    if (r != SUDOKU_OK) {
+        fprintf(stderr, "Failed to write %s\n", out_path);
+        return 1;
+    }
+    printf("OK: %d puzzles stored in %s (%d skipped, not unique)\n", count, out_path, skipped);
+    return 0;
+}
+
+//grades puzzles into the log, batch by batch; compacts into the store every few batches and at the end
+//the log cursor is the number of input lines done, so a rerun skips them
+static int ingest(int argc, char** argv) {
+    const char* in_path = argv[0];
+    const char* store_path = argv[1];
+    const char* log_path = NULL;
+    int batch = 256;
+    long compact_every = 0;
+    for (int i = 2; i < argc; ++i) {
+        if (strcmp(argv[i], "--log") == 0 && i + 1 < argc) log_path = argv[++i];
+        else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) batch = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--compact-every") == 0 && i + 1 < argc) compact_every = atol(argv[++i]);
+        else return 2;
+    }
+
+    char default_log[512];
+    if (!log_path) {
+        snprintf(default_log, sizeof(default_log), "%s.log", store_path);
+        log_path = default_log;
+    }
+
+    //puzzles in the store before this run (none if there is no store yet)
+    long before = 0;
+    SudokuStore store;
+    FILE* probe = fopen(store_path, "rb");
+    if (probe) {
+        fclose(probe);
+        if (sudoku_store_open(&store, store_path) != SUDOKU_OK) {
+            fprintf(stderr, "Failed to open store %s\n", store_path);
+            return 1;
+        }
+        before = store.count;
+        sudoku_store_close(&store);
+    }
+
+    SudokuLog log;
+    if (sudoku_log_open(&log, log_path, store_path, batch) != SUDOKU_OK) {
+        fprintf(stderr, "Failed to open log %s\n", log_path);
+        return 1;
+    }
+    if (log.cursor > 0) {
+        printf("Resuming after line %lu (%ld puzzles in the log)\n", (unsigned long)log.cursor, log.committed);
+    }
+
+    FILE* f = fopen(in_path, "r");
+    if (!f) {
+        fprintf(stderr, "Failed to open %s\n", in_path);
+        sudoku_log_close(&log);
+        return 1;
+    }
+
+    uint64_t line_no = 0;
+    long added = 0, skipped = 0;
+    uint32_t last_compact = log.seq;
+    SudokuResult r = SUDOKU_OK;
+    char line[256];
+    while (r == SUDOKU_OK && fgets(line, sizeof(line), f)) {
+        ++line_no;
+        if (line_no <= log.cursor) continue;
+
+        SudokuStoreEntry e;
+        e.served = 0;
+        if (!sudoku_board_from_string(line, &e.puzzle)) continue;
+        if (sudoku_count_solutions(&e.puzzle, 2, NULL) != 1 || sudoku_grade(&e.puzzle, &e.grade) != SUDOKU_OK) {
+            ++skipped;
+            continue;
+        }
+        r = sudoku_log_append(&log, &e, line_no);
+        ++added;
+        if (r == SUDOKU_OK && compact_every > 0 && log.seq - last_compact >= (uint32_t)compact_every) {
+            r = sudoku_log_compact(&log, store_path);
+            last_compact = log.seq;
+        }
+    }
+    fclose(f);
+
+    if (r == SUDOKU_OK) r = sudoku_log_compact(&log, store_path);
+    sudoku_log_close(&log);
+    if (r == SUDOKU_ERR_INVALID_ARG) {
+        fprintf(stderr, "The log %s is behind %s (it was not started from this store), nothing was added\n", log_path, store_path);
+        return 1;
+    }
+    if (r != SUDOKU_OK) {
+        fprintf(stderr, "Failed to write %s (the log keeps what was committed, run again to go on)\n", store_path);
+        return 1;
+    }
+    //everything added in this run has to be in the store now (a resumed run adds more: the
+    //batches its crashed predecessor logged); only then can the log go
+    long after = -1;
+    if (sudoku_store_open(&store, store_path) == SUDOKU_OK) {
+        after = store.count;
+        sudoku_store_close(&store);
+    }
+    if (after < before + added) {
+        fprintf(stderr, "Store %s has %ld puzzles, expected at least %ld; the log %s is kept\n",
+            store_path, after, before + added, log_path);
+        return 1;
+    }
+    //the job is done, the next ingest starts from the first line again
+    remove(log_path);
+    printf("OK: %ld puzzles added to %s (%ld skipped, not unique), %ld in the store\n", added, store_path, skipped, after);
+    return 0;
+}
+
+static int pack(const char* in_path, const char* out_path) {
+    FILE* f = fopen(in_path, "r");
+    if (!f) {
+        fprintf(stderr, "Failed to open %s\n", in_path);
+        return 1;
+    }
+
+    SudokuArchiveWriter w;
+    sudoku_archive_writer_init(&w);
+    long text_bytes = 0, skipped = 0;
+    char line[512];
+    while (fgets(line, sizeof(line), f)) {
+        SudokuBoard puzzle, solution;
+        if (!sudoku_board_from_string(line, &puzzle)) continue;
+
+        //"<puzzle> <solution>" lines keep their solution, others are solved
+        const char* rest = line + 81;
+        while (*rest == ' ' || *rest == '\t') ++rest;
+        if (!sudoku_board_from_string(rest, &solution) || sudoku_archive_add(&w, &puzzle, &solution) != SUDOKU_OK) {
+            if (sudoku_count_solutions(&puzzle, 1, &solution) != 1 ||
+                sudoku_archive_add(&w, &puzzle, &solution) != SUDOKU_OK) {
+                ++skipped;
+                continue;
+            }
+        }
+        text_bytes += 164;
+    }
+    fclose(f);
+
+    SudokuResult r = sudoku_archive_write(&w, out_path);
+    long bytes = 32L + (long)w.grid_count * SUDOKU_ARCHIVE_GRID_SIZE + (long)w.puzzle_count * SUDOKU_ARCHIVE_RECORD_SIZE;
+    printf("OK: %d puzzles on %d grids, %ld bytes (%ld as text), %ld skipped\n",
+        w.puzzle_count, w.grid_count, bytes, text_bytes, skipped);
+    sudoku_archive_writer_free(&w);
+    if (r != SUDOKU_OK) {
+        fprintf(stderr, "Failed to write %s\n", out_path);
+        return 1;
+    }
+    return 0;
+}
+
+static int unpack(const char* path) {
+    SudokuArchive a;
+    if (sudoku_archive_open(&a, path) != SUDOKU_OK) {
+        fprintf(stderr, "Failed to open archive %s\n", path);
+        return 1;
+    }
+    for (int i = 0; i < a.puzzle_count; ++i) {
+        SudokuBoard puzzle, solution;
+        if (sudoku_archive_get(&a, i, &puzzle, &solution) != SUDOKU_OK) {
+            fprintf(stderr, "Archive record %d is broken\n", i);
+            sudoku_archive_close(&a);
+            return 1;
+        }
+        char p[82], s[82];
+        sudoku_board_to_string(&puzzle, p);
+        sudoku_board_to_string(&solution, s);
+        printf("%s %s\n", p, s);
+    }
+    sudoku_archive_close(&a);
+    return 0;
+}
+
+static int query(int argc, char** argv) {
+    const char* path = argv[0];
+    SudokuStoreQuery q;
+    sudoku_store_query_init(&q);
+    int limit = 1, only_count = 0, mark = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        SudokuTechnique t;
+        if (strcmp(argv[i], "--difficulty") == 0 && i + 1 < argc) {
+            ++i;
+            if (strcmp(argv[i], "easy") == 0) q.difficulty = SUDOKU_DIFFICULTY_EASY;
+            else if (strcmp(argv[i], "medium") == 0) q.difficulty = SUDOKU_DIFFICULTY_MEDIUM;
+            else if (strcmp(argv[i], "hard") == 0) q.difficulty = SUDOKU_DIFFICULTY_HARD;
+            else return 2;
+        }
+        else if (strcmp(argv[i], "--tech") == 0 && i + 1 < argc && parse_technique(argv[i + 1], &t)) {
+            q.techniques |= 1u << t;
+            ++i;
+        }
+        else if (strcmp(argv[i], "--clues") == 0 && i + 1 < argc && parse_range(argv[i + 1], &q.min_clues, &q.max_clues)) ++i;
+        else if (strcmp(argv[i], "--score") == 0 && i + 1 < argc && parse_range(argv[i + 1], &q.min_score, &q.max_score)) ++i;
+        else if (strcmp(argv[i], "--limit") == 0 && i + 1 < argc) limit = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--unserved") == 0) q.unserved_only = 1;
+        else if (strcmp(argv[i], "--mark") == 0) mark = 1;
+        else if (strcmp(argv[i], "--count") == 0) only_count = 1;
+        else return 2;
+    }
+
+    SudokuStore store;
+    if (sudoku_store_open(&store, path) != SUDOKU_OK) {
+        fprintf(stderr, "Failed to open store %s\n", path);
+        return 1;
+    }
+
+    if (only_count) {
+        printf("%d\n", sudoku_store_count(&store, &q));
+        sudoku_store_close(&store);
+        return 0;
+    }
+
+    for (int n = 0; n < limit; ++n) {
+        int id = sudoku_store_pick(&store, &q);
+        if (id < 0) break;
+        SudokuStoreEntry e;
+        sudoku_store_get(&store, id, &e);
+        char s[82];
+        sudoku_board_to_string(&e.puzzle, s);
+        printf("%s %d %s\n", s, e.grade.score, sudoku_technique_name((SudokuTechnique)e.grade.hardest));
+        //served puzzles drop out of later --unserved picks in this loop too
+        if (mark && sudoku_store_mark_served(&store, id) != SUDOKU_OK) {
+            fprintf(stderr, "Failed to mark puzzle %d as served\n", id);
+        }
+    }
+    sudoku_store_close(&store);
+    return 0;
+}
+
+//wall clock microseconds (on posix clock() is cpu time, summed over all threads)
+static double now_us(void) {
+#ifdef _WIN32
+    return (double)clock() * 1e6 / CLOCKS_PER_SEC; // wall clock time on windows
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e6 + (double)ts.tv_nsec / 1e3;
+#endif
+}
+
+//thumbnails are rendered this many at a time (one batch = one round of threads)
+#define THUMB_BATCH 256
+
+typedef struct ThumbQueue {
+    SudokuBoard puzzles[THUMB_BATCH];
+    char paths[THUMB_BATCH][1024];
+    SudokuThumbJob jobs[THUMB_BATCH];
+    int count;
+    int size, threads;
+} ThumbQueue;
+
+static int flush_thumbs(ThumbQueue* q) {
+    for (int i = 0; i < q->count; ++i) {
+        q->jobs[i].puzzle = &q->puzzles[i];
+        q->jobs[i].path = q->paths[i];
+    }
+    SudokuResult r = sudoku_thumb_batch(q->jobs, q->count, q->size, q->threads);
+    for (int i = 0; i < q->count && r != SUDOKU_OK; ++i) {
+        if (q->jobs[i].result != SUDOKU_OK) {
+            fprintf(stderr, "Failed to write thumbnail %s\n", q->paths[i]);
+            break;
+        }
+    }
+    q->count = 0;
+    return r == SUDOKU_OK;
+}
+
+static int site(int argc, char** argv) {
+    const char* archive_path = argv[0];
+    const char* dir = argv[1];
+    const char* template_path = NULL;
+    const char* base_url = NULL;
+    const char* title = "Sudoku";
+    int per_page = 100, limit = -1, shard = 0;
+    int thumbs = 0, thumb_size = 360, threads = 4;
+    SudokuPageOptions options = {0};
+    for (int i = 2; i < argc; ++i) {
+        if (strcmp(argv[i], "--template") == 0 && i + 1 < argc) template_path = argv[++i];
+        else if (strcmp(argv[i], "--base-url") == 0 && i + 1 < argc) base_url = argv[++i];
+        else if (strcmp(argv[i], "--title") == 0 && i + 1 < argc) title = argv[++i];
+        else if (strcmp(argv[i], "--per-page") == 0 && i + 1 < argc) per_page = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--limit") == 0 && i + 1 < argc) limit = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--compact") == 0) options.compact = 1;
+        else if (strcmp(argv[i], "--shard") == 0) shard = 1;
+        else if (strcmp(argv[i], "--thumbs") == 0) thumbs = 1;
+        else if (strcmp(argv[i], "--thumb-size") == 0 && i + 1 < argc) thumb_size = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) threads = atoi(argv[++i]);
+        else return 2;
+    }
+    if (per_page <= 0 || thumb_size < SUDOKU_THUMB_MIN_SIZE || thumb_size > SUDOKU_THUMB_MAX_SIZE) return 2;
+
+    SudokuTemplate tpl;
+    SudokuResult r = template_path ? sudoku_template_load(&tpl, template_path)
+                                   : sudoku_template_compile(&tpl, sudoku_template_default_text());
+    if (r != SUDOKU_OK) {
+        fprintf(stderr, "Failed to read template %s (line %d)\n", template_path ? template_path : "(built-in)", tpl.error_line);
+        return 1;
+    }
+    SudokuArchive a;
+    if (sudoku_archive_open(&a, archive_path) != SUDOKU_OK) {
+        fprintf(stderr, "Failed to open archive %s\n", archive_path);
+        sudoku_template_free(&tpl);
+        return 1;
+    }
+
+    //the theme rules are the same on every page: one shared stylesheet
+    SudokuTheme theme = {0};
+    theme.panel_bg = "#dabfae";
+    theme.cell_hover_bg = "wheat";
+    char theme_css[32];
+    SudokuSiteIndex index;
+    if (sudoku_write_theme_css(dir, &theme, theme_css, sizeof(theme_css)) != SUDOKU_OK ||
+        sudoku_site_index_open(&index, dir, base_url, title, "style.css", per_page, shard) != SUDOKU_OK) {
+        fprintf(stderr, "Failed to write into %s (does the folder exist?)\n", dir);
+        sudoku_archive_close(&a);
+        sudoku_template_free(&tpl);
+        return 1;
+    }
+    //sharded pages are two folders down
+    const char* root = sudoku_site_page_root(&index);
+    char css_href[64], theme_href[64];
+    snprintf(css_href, sizeof(css_href), "%sstyle.css", root);
+    snprintf(theme_href, sizeof(theme_href), "%s%s", root, theme_css);
+    options.theme_css = theme_href;
+    options.root = root;
+
+    //one parts buffer for all pages, the template text is shared
+    static SudokuTrace trace;
+    static char trace_b64[SUDOKU_TRACE_MAX_STEPS * 4 + 1];
+    SudokuPageParts page;
+    sudoku_page_parts_init(&page);
+    static ThumbQueue queue;
+    queue.count = 0;
+    queue.size = thumb_size;
+    queue.threads = threads;
+    int n = (limit >= 0 && limit < a.puzzle_count) ? limit : a.puzzle_count;
+    double t0 = now_us();
+    int rc = 0;
+    for (int i = 0; i < n && rc == 0; ++i) {
+        SudokuBoard puzzle, solution;
+        if (sudoku_archive_get(&a, i, &puzzle, &solution) != SUDOKU_OK) {
+            fprintf(stderr, "Archive record %d is broken\n", i);
+            rc = 1;
+            break;
+        }
+        SudokuGrade grade;
+        options.trace = NULL;
+        int graded = sudoku_grade_trace(&puzzle, &solution, &grade, &trace) == SUDOKU_OK;
+        if (graded && sudoku_trace_to_base64(&trace, trace_b64, sizeof(trace_b64))) options.trace = trace_b64;
+        SudokuDifficulty d = graded ? sudoku_grade_difficulty(&grade) : SUDOKU_DIFFICULTY_MEDIUM;
+
+        char href[64], page_title[160], path[1024];
+        if (sudoku_site_page_path(&index, i + 1, href, sizeof(href), path, sizeof(path)) != SUDOKU_OK) {
+            fprintf(stderr, "Failed to create the folder for page %d\n", i + 1);
+            rc = 1;
+            break;
+        }
+        snprintf(page_title, sizeof(page_title), "%s #%d", title, i + 1);
+        theme.page_title = page_title;
+
+        //the preview sits next to the page: 12.html -> 12.png
+        char image_url[1024];
+        options.image = NULL;
+        if (thumbs) {
+            char* png_path = queue.paths[queue.count];
+            snprintf(png_path, sizeof(queue.paths[0]), "%.*s.png", (int)(strlen(path) - 5), path);
+            queue.puzzles[queue.count++] = puzzle;
+            if (index.base_url) {
+                snprintf(image_url, sizeof(image_url), "%s%.*s.png", index.base_url, (int)(strlen(href) - 5), href);
+                options.image = image_url;
+            }
+            if (queue.count == THUMB_BATCH && !flush_thumbs(&queue)) {
+                rc = 1;
+                break;
+            }
+        }
+
+        SudokuSiteEntry entry;
+        entry.href = href;
+        entry.title = page_title;
+        entry.difficulty = graded ? (int)d : -1;
+        entry.clues = sudoku_count_clues(&puzzle);
+        entry.score = graded ? grade.score : -1;
+
+        if (sudoku_template_render(&tpl, &page, css_href, &puzzle, &solution, &theme, d, &options) != SUDOKU_OK ||
+            sudoku_page_parts_write_file(&page, path) != SUDOKU_OK ||
+            sudoku_site_index_add(&index, &entry) != SUDOKU_OK) {
+            fprintf(stderr, "Failed to write page %s\n", path);
+            rc = 1;
+        }
+    }
+    if (rc == 0 && queue.count > 0 && !flush_thumbs(&queue)) rc = 1;
+    if (sudoku_site_index_close(&index) != SUDOKU_OK && rc == 0) {
+        fprintf(stderr, "Failed to finish the index files in %s\n", dir);
+        rc = 1;
+    }
+    double secs = (now_us() - t0) / 1e6;
+    if (rc == 0) {
+        printf("OK: %d pages in %.1f s (%s + index pages, manifest.json%s%s)\n",
+            n, secs, theme_css, base_url ? ", sitemaps" : "", thumbs ? ", png previews" : "");
+    }
+    sudoku_page_parts_free(&page);
+    sudoku_archive_close(&a);
+    sudoku_template_free(&tpl);
+    return rc;
+}
+
+//bench
+
+//latency histogram in microseconds: exact below 16, then 16 buckets per power of two (~6%)
+#define HIST_BUCKETS (16 + 40 * 16)
+
+typedef struct Histogram {
+    long counts[HIST_BUCKETS];
+    long total;
+    double max_us;
+} Histogram;
+
+static int hist_bucket(double us) {
+    unsigned long long v = us > 0 ? (unsigned long long)us : 0;
+    if (v < 16) return (int)v;
+    int e = 4;
+    while (e < 43 && (v >> (e + 1)) != 0) ++e;
+    int idx = 16 + (e - 4) * 16 + (int)((v >> (e - 4)) & 15);
+    return idx < HIST_BUCKETS ? idx : HIST_BUCKETS - 1;
+}
+
+//largest value that lands in bucket idx
+static double hist_bucket_top(int idx) {
+    if (idx < 16) return idx;
+    int e = (idx - 16) / 16 + 4, sub = (idx - 16) % 16;
+    return (double)((1ull << e) + ((unsigned long long)(sub + 1) << (e - 4)) - 1);
+}
+
+static void hist_add(Histogram* h, double us) {
+    ++h->counts[hist_bucket(us)];
+    ++h->total;
+    if (us > h->max_us) h->max_us = us;
+}
+
+static double hist_percentile(const Histogram* h, double p) {
+    if (h->total == 0) return 0;
+    long want = (long)(p / 100.0 * (double)h->total + 0.5), seen = 0;
+    if (want < 1) want = 1;
+    for (int i = 0; i < HIST_BUCKETS; ++i) {
+        seen += h->counts[i];
+        if (seen >= want) return hist_bucket_top(i) < h->max_us ? hist_bucket_top(i) : h->max_us;
+    }
+    return h->max_us;
+}
+
+static void print_hist_row(const char* name, const Histogram* h) {
+    if (h->total == 0) return;
+    printf("  %-8s %8ld %9.2f %9.2f %9.2f %9.2f %9.2f\n", name, h->total,
+        hist_percentile(h, 50) / 1000, hist_percentile(h, 90) / 1000, hist_percentile(h, 99) / 1000,
+        hist_percentile(h, 99.9) / 1000, h->max_us / 1000);
+}
+
+
+//the os wakes a sleeper up late (~0.1 ms, more under load), which would count as request latency:
+//sleep until shortly before t and spin the rest
+#define SPIN_US 200.0
+#define WIN_TICK_US 15625.0
+
+static void sleep_until(double t_us) {
+    double left = t_us - now_us() - SPIN_US;
+#ifndef _WIN32
+    if (left > 0) {
+        struct timespec ts;
+        ts.tv_sec = (time_t)(left / 1e6);
+        ts.tv_nsec = (long)((left - (double)ts.tv_sec * 1e6) * 1e3);
+        nanosleep(&ts, NULL);
+    }
+#else
+    //Sleep() wakes on the next timer tick (15.6 ms unless something raised the timer rate),
+    //so it stops one tick earlier
+    left -= WIN_TICK_US;
+    if (left >= 1000) Sleep((DWORD)(left / 1000));
+#endif
+    while (now_us() < t_us) {
+    }
+}
+
+enum { BENCH_PAGE, BENCH_RENDER, BENCH_THUMB, BENCH_OPS };
+static const char* const bench_op_names[BENCH_OPS] = { "page", "render", "thumb" };
+
+//puzzles graded up front for the render op (a page whose grade and trace are already known)
+#define BENCH_CACHED 64
+
+static int bench(int argc, char** argv) {
+    const char* archive_path = argv[0];
+    const char* template_path = NULL;
+    double rate = 0, seconds = 5;
+    int mix[BENCH_OPS] = { 20, 75, 5 };
+    int thumb_size = 360;
+    SudokuPageOptions options = {0};
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--rate") == 0 && i + 1 < argc) rate = atof(argv[++i]);
+        else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) seconds = atof(argv[++i]);
+        else if (strcmp(argv[i], "--mix") == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%d,%d,%d", &mix[0], &mix[1], &mix[2]) != 3) return 2;
+        }
+        else if (strcmp(argv[i], "--template") == 0 && i + 1 < argc) template_path = argv[++i];
+        else if (strcmp(argv[i], "--compact") == 0) options.compact = 1;
+        else if (strcmp(argv[i], "--thumb-size") == 0 && i + 1 < argc) thumb_size = atoi(argv[++i]);
+        else return 2;
+    }
+    int mix_total = mix[0] + mix[1] + mix[2];
+    if (rate < 0 || seconds <= 0 || mix[0] < 0 || mix[1] < 0 || mix[2] < 0 || mix_total <= 0 ||
+        thumb_size < SUDOKU_THUMB_MIN_SIZE || thumb_size > SUDOKU_THUMB_MAX_SIZE) {
+        return 2;
+    }
+
+    SudokuTemplate tpl;
+    SudokuResult r = template_path ? sudoku_template_load(&tpl, template_path)
+                                   : sudoku_template_compile(&tpl, sudoku_template_default_text());
+    if (r != SUDOKU_OK) {
+        fprintf(stderr, "Failed to read template %s (line %d)\n", template_path ? template_path : "(built-in)", tpl.error_line);
+        return 1;
+    }
+    SudokuArchive a;
+    if (sudoku_archive_open(&a, archive_path) != SUDOKU_OK || a.puzzle_count == 0) {
+        fprintf(stderr, "Failed to open archive %s (or it is empty)\n", archive_path);
+        sudoku_template_free(&tpl);
+        return 1;
+    }
+
+    SudokuTheme theme = {0};
+    theme.panel_bg = "#dabfae";
+    theme.cell_hover_bg = "wheat";
+    theme.page_title = "Sudoku";
+    options.theme_css = "theme.css";
+
+    static SudokuTrace trace;
+    static char trace_b64[SUDOKU_TRACE_MAX_STEPS * 4 + 1];
+    static SudokuBoard cached_puzzle[BENCH_CACHED], cached_solution[BENCH_CACHED];
+    static char cached_trace[BENCH_CACHED][SUDOKU_TRACE_MAX_STEPS * 4 + 1];
+    static SudokuDifficulty cached_difficulty[BENCH_CACHED];
+    int cached = a.puzzle_count < BENCH_CACHED ? a.puzzle_count : BENCH_CACHED;
+    for (int i = 0; i < cached; ++i) {
+        SudokuGrade grade;
+        cached_trace[i][0] = '\0';
+        cached_difficulty[i] = SUDOKU_DIFFICULTY_MEDIUM;
+        if (sudoku_archive_get(&a, i, &cached_puzzle[i], &cached_solution[i]) != SUDOKU_OK) {
+            fprintf(stderr, "Archive record %d is broken\n", i);
+            sudoku_archive_close(&a);
+            sudoku_template_free(&tpl);
+            return 1;
+        }
+        if (sudoku_grade_trace(&cached_puzzle[i], &cached_solution[i], &grade, &trace) == SUDOKU_OK) {
+            sudoku_trace_to_base64(&trace, cached_trace[i], sizeof(cached_trace[i]));
+            cached_difficulty[i] = sudoku_grade_difficulty(&grade);
+        }
+    }
+
+    //open loop: request i is due at start + i / rate whether or not the earlier ones are done.
+    //latency counts from that planned time, so a slow request also charges the wait it caused
+    //for the ones queued behind it (a closed loop, which only times requests it managed to
+    //send, hides exactly that). without --rate: back to back, latency = service time
+    static Histogram latency[BENCH_OPS], service[BENCH_OPS];
+    SudokuPageParts page;
+    sudoku_page_parts_init(&page);
+    SudokuThumbWriter thumbs;
+    if (sudoku_thumb_writer_init(&thumbs, thumb_size) != SUDOKU_OK) {
+        fprintf(stderr, "Failed to set up %d px thumbnails\n", thumb_size);
+        sudoku_page_parts_free(&page);
+        sudoku_archive_close(&a);
+        sudoku_template_free(&tpl);
+        return 1;
+    }
+    size_t png_bytes = 0;
+    double interval = rate > 0 ? 1e6 / rate : 0;
+    double start = now_us(), end = start + seconds * 1e6;
+    long sent = 0, skipped = 0, next_page = 0;
+    size_t page_bytes = 0;
+    int rc = 0;
+    for (;; ++sent) {
+        double planned = rate > 0 ? start + (double)sent * interval : now_us();
+        if (planned >= end) break;
+        if (rate > 0) sleep_until(planned);
+        //far behind: give up after twice the planned time, what is left only counts as skipped
+        if (now_us() >= end + seconds * 1e6) {
+            skipped = (long)((end - planned) / interval) + 1;
+            break;
+        }
+
+        int pick = rand() % mix_total;
+        int op = pick < mix[0] ? BENCH_PAGE : pick < mix[0] + mix[1] ? BENCH_RENDER : BENCH_THUMB;
+        double t1 = now_us();
+        if (op == BENCH_PAGE) {
+            //what `site` does per page, minus the file: decode, grade with trace, render
+            SudokuBoard puzzle, solution;
+            SudokuGrade grade;
+            int at = (int)(next_page++ % a.puzzle_count);
+            r = sudoku_archive_get(&a, at, &puzzle, &solution);
+            options.trace = NULL;
+            SudokuDifficulty d = SUDOKU_DIFFICULTY_MEDIUM;
+            if (r == SUDOKU_OK && sudoku_grade_trace(&puzzle, &solution, &grade, &trace) == SUDOKU_OK) {
+                if (sudoku_trace_to_base64(&trace, trace_b64, sizeof(trace_b64))) options.trace = trace_b64;
+                d = sudoku_grade_difficulty(&grade);
+            }
+            if (r == SUDOKU_OK) r = sudoku_template_render(&tpl, &page, "style.css", &puzzle, &solution, &theme, d, &options);
+            page_bytes += sudoku_page_parts_size(&page);
+        } else if (op == BENCH_RENDER) {
+            int at = rand() % cached;
+            options.trace = cached_trace[at][0] ? cached_trace[at] : NULL;
+            r = sudoku_template_render(&tpl, &page, "style.css", &cached_puzzle[at], &cached_solution[at], &theme,
+                cached_difficulty[at], &options);
+            page_bytes += sudoku_page_parts_size(&page);
+        } else {
+            //the encoder alone: the atlas is made once for the run and the png stays in memory
+            const unsigned char* png;
+            size_t png_len;
+            r = sudoku_thumb_writer_encode(&thumbs, &cached_puzzle[rand() % cached], &png, &png_len);
+            png_bytes += png_len;
+        }
+        double t2 = now_us();
+        if (r != SUDOKU_OK) {
+            fprintf(stderr, "bench: %s failed\n", bench_op_names[op]);
+            rc = 1;
+            break;
+        }
+        hist_add(&service[op], t2 - t1);
+        hist_add(&latency[op], t2 - planned);
+    }
+    double secs = (now_us() - start) / 1e6;
+
+    if (rc == 0) {
+        long done = 0;
+        for (int op = 0; op < BENCH_OPS; ++op) done += latency[op].total;
+        if (rate > 0) printf("planned %.0f/s for %.1f s, ", rate, seconds);
+        long pages = latency[BENCH_PAGE].total + latency[BENCH_RENDER].total;
+        printf("done %ld in %.1f s (%.0f/s)", done, secs, (double)done / secs);
+        if (pages > 0) printf(", %.1f kb per page", (double)page_bytes / 1024 / (double)pages);
+        if (latency[BENCH_THUMB].total > 0) printf(", %.1f kb per png", (double)png_bytes / 1024 / (double)latency[BENCH_THUMB].total);
+        printf("\n");
+        if (skipped > 0) printf("fell behind: %ld planned requests never started\n", skipped);
+        printf("latency from planned start (ms):\n");
+        printf("  %-8s %8s %9s %9s %9s %9s %9s\n", "op", "count", "p50", "p90", "p99", "p99.9", "max");
+        for (int op = 0; op < BENCH_OPS; ++op) print_hist_row(bench_op_names[op], &latency[op]);
+        if (rate > 0) {
+            printf("service time (ms):\n");
+            for (int op = 0; op < BENCH_OPS; ++op) print_hist_row(bench_op_names[op], &service[op]);
+        }
+    }
+    sudoku_thumb_writer_free(&thumbs);
+    sudoku_page_parts_free(&page);
+    sudoku_archive_close(&a);
+    sudoku_template_free(&tpl);
+    return rc;
+}
+
+int main(int argc, char** argv) {
+    sudoku_seed((unsigned int)time(NULL));
+
+    int rc = 2;
+    if (argc == 4 && strcmp(argv[1], "build") == 0) rc = build(argv[2], argv[3]);
+    else if (argc >= 4 && strcmp(argv[1], "ingest") == 0) rc = ingest(argc - 2, argv + 2);
+    else if (argc >= 3 && strcmp(argv[1], "query") == 0) rc = query(argc - 2, argv + 2);
+    else if (argc == 4 && strcmp(argv[1], "pack") == 0) rc = pack(argv[2], argv[3]);
+    else if (argc == 3 && strcmp(argv[1], "unpack") == 0) rc = unpack(argv[2]);
+    else if (argc >= 4 && strcmp(argv[1], "site") == 0) rc = site(argc - 2, argv + 2);
+    else if (argc >= 3 && strcmp(argv[1], "bench") == 0) rc = bench(argc - 2, argv + 2);
+
+    if (rc == 2) {
+        fprintf(stderr,
+            "usage: %s build puzzles.txt store.sdb\n"
+            "       %s ingest puzzles.txt store.sdb [--log store.sdb.log] [--batch N] [--compact-every N]\n"
+            "       %s query store.sdb [--difficulty easy|medium|hard] [--tech name]... [--clues A-B]\n"
+            "                          [--score A-B] [--unserved] [--mark] [--limit N] [--count]\n"
+            "       %s pack puzzles.txt archive.sda\n"
+            "       %s unpack archive.sda\n"
+            "       %s site archive.sda dir [--template page.html] [--compact] [--shard] [--base-url URL]\n"
+            "                          [--title T] [--per-page N] [--limit N] [--thumbs] [--thumb-size PX] [--threads N]\n"
+            "       %s bench archive.sda [--rate N] [--seconds S] [--mix PAGE,RENDER,THUMB] [--template page.html]\n"
+            "                          [--compact] [--thumb-size PX]\n",
+            argv[0], argv[0], argv[0], argv[0], argv[0], argv[0], argv[0]);
+        return 1;
+    }
+    return rc;
+}
@@ -0,0 +1,518 @@
+// sudoku_dedupe.c - canonical puzzle hashes and the seen set
+
+//fileno / fcntl locks are posix, not c99
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200112L
+#endif
+
+#include "sudoku_dedupe.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#endif
+
+#define SEEN_VERSION 1
+#define SEEN_HEADER 16
+#define SEEN_MIN_CAP 1024
+
+#define CANON_INF 10
+
+//canonical form
+//the variants are: transpose or not x column order (band order x order inside each band,
+//1296) x row order; digits are relabeled 1, 2, 3.. in order of first appearance, so that
+//part needs no search. rows are chosen one at a time, level by level, and only the
+//(transpose, column order, rows so far) states whose prefix is the smallest survive
+//to keep the number of ties down, only orders sorted by clue count are tried: bands and
+//stacks by their number of clues, rows and columns inside them by theirs (fewest first)
+//clue counts do not change under any of the transformations, so this is still one fixed
+//representative per class; it just skips orders that could never be picked anyway
+//for very empty boards (thousands of ties) it switches to a depth first search to bound memory
+
+#define COL_ORDERS 1296
+#define MAX_STATES 65536
+
+static const int perm3[6][3] = {
+    {0, 1, 2}, {0, 2, 1}, {1, 0, 2}, {1, 2, 0}, {2, 0, 1}, {2, 1, 0}
+};
+
+typedef struct CanonState {
+    unsigned short order;       // t * COL_ORDERS + column order
+    unsigned short used;        // rows used so far
+    unsigned char band;         // band of the last row
+    unsigned char next;         // next digit label
+    unsigned char map[10];      // digit -> label
+} CanonState;
+
+typedef struct Canon {
+    unsigned char g[2][9][9];               // puzzle and its transpose
+    unsigned char colmap[COL_ORDERS][9];    // new column -> old column
+    unsigned char best[81];
+    int row_clues[2][9];
+    int band_clues[2][3];
+} Canon;
+
+//sorted by (band total, count) with ties in any order
+static int order_is_sorted(const int* clues, const int* totals, const unsigned char* map) {
+    for (int k = 1; k < 9; ++k) {
+        int prev = map[k - 1], cur = map[k];
+        if (k % 3 == 0) {
+            if (totals[cur / 3] < totals[prev / 3]) return 0;
+        } else if (clues[cur] < clues[prev]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+//relabels `row` of state `st` into out and compares it with best_row as it goes
+//returns -1 (smaller), 0 (equal) or 1 (bigger, out is incomplete)
+static int eval_row(const Canon* c, const CanonState* st, int row, CanonState* next_st, unsigned char* out, const unsigned char* best_row) {
+    const unsigned char* src = c->g[st->order / COL_ORDERS][row];
+    const unsigned char* cm = c->colmap[st->order % COL_ORDERS];
+    *next_st = *st;
+    int cmp = 0;
+    for (int j = 0; j < 9; ++j) {
+        int v = src[cm[j]];
+        if (v != 0) {
+            if (next_st->map[v] == 0) next_st->map[v] = next_st->next++;
+            v = next_st->map[v];
+        }
+        out[j] = (unsigned char)v;
+        if (cmp == 0 && v != best_row[j]) {
+            if (v > best_row[j]) return 1;
+            cmp = -1;
+        }
+    }
+    next_st->used = (unsigned short)(st->used | (1 << row));
+    next_st->band = (unsigned char)(row / 3);
+    return cmp;
+}
+
+//rows that can come at position p: the fewest clues among the allowed ones
+static int row_allowed(const Canon* c, const CanonState* st, int p, int row) {
+    if (st->used & (1 << row)) return 0;
+    const int* clues = c->row_clues[st->order / COL_ORDERS];
+    const int* totals = c->band_clues[st->order / COL_ORDERS];
+    if (p % 3 == 0) {
+        //a new band: unused band with the fewest clues, and its sparsest row
+        if (st->used & (7 << (row / 3 * 3))) return 0;
+        for (int other = 0; other < 9; ++other) {
+            if (st->used & (7 << (other / 3 * 3))) continue;
+            if (totals[other / 3] < totals[row / 3]) return 0;
+            if (other / 3 == row / 3 && clues[other] < clues[row]) return 0;
+        }
+        return 1;
+    }
+    if (row / 3 != st->band) return 0;
+    for (int other = st->band * 3; other < st->band * 3 + 3; ++other) {
+        if (!(st->used & (1 << other)) && clues[other] < clues[row]) return 0;
+    }
+    return 1;
+}
+
+//depth first fallback from one state at position p, prunes against c->best
+static void canon_dfs(Canon* c, const CanonState* st, int p) {
+    if (p == 9) return;
+    for (int row = 0; row < 9; ++row) {
+        if (!row_allowed(c, st, p, row)) continue;
+        CanonState ns;
+        unsigned char out[9];
+        int cmp = eval_row(c, st, row, &ns, out, &c->best[p * 9]);
+        if (cmp > 0) continue;
+        if (cmp < 0) {
+            //new best prefix, everything after it is unknown again
+            memcpy(&c->best[p * 9], out, 9);
+            memset(&c->best[(p + 1) * 9], CANON_INF, (size_t)(81 - (p + 1) * 9));
+        }
+        canon_dfs(c, &ns, p + 1);
+    }
+}
+
+void sudoku_canonical_form(const SudokuBoard* puzzle, SudokuBoard* out_form) {
+    if (!puzzle || !out_form) return;
+
+    Canon* c = (Canon*)malloc(sizeof(Canon));
+    CanonState* a = (CanonState*)malloc(MAX_STATES * sizeof(CanonState));
+    CanonState* b = (CanonState*)malloc(MAX_STATES * sizeof(CanonState));
+    if (!c || !a || !b) {
+        //no memory: the puzzle itself is still a usable (not canonical) form
+        free(c);
+        free(a);
+        free(b);
+        sudoku_copy(out_form, puzzle);
+        return;
+    }
+
+    memset(c->row_clues, 0, sizeof(c->row_clues));
+    memset(c->band_clues, 0, sizeof(c->band_clues));
+    for (int r = 0; r < 9; ++r) {
+        for (int col = 0; col < 9; ++col) {
+            c->g[0][r][col] = (unsigned char)puzzle->cell[r][col];
+            c->g[1][r][col] = (unsigned char)puzzle->cell[col][r];
+            if (puzzle->cell[r][col] != 0) {
+                ++c->row_clues[0][r];
+                ++c->row_clues[1][col];
+                ++c->band_clues[0][r / 3];
+                ++c->band_clues[1][col / 3];
+            }
+        }
+    }
+    for (int i = 0; i < COL_ORDERS; ++i) {
+        const int* bands = perm3[i / 216];
+        const int* inner[3] = {perm3[i / 36 % 6], perm3[i / 6 % 6], perm3[i % 6]};
+        for (int k = 0; k < 9; ++k) c->colmap[i][k] = (unsigned char)(bands[k / 3] * 3 + inner[k / 3][k % 3]);
+    }
+    memset(c->best, CANON_INF, sizeof(c->best));
+
+    //level 0: every transpose x sorted column order, nothing chosen yet
+    //(the columns of one side are the rows of the transpose)
+    int n = 0;
+    for (int i = 0; i < 2 * COL_ORDERS; ++i) {
+        int t = i / COL_ORDERS;
+        if (!order_is_sorted(c->row_clues[1 - t], c->band_clues[1 - t], c->colmap[i % COL_ORDERS])) continue;
+        memset(&a[n], 0, sizeof(CanonState));
+        a[n].order = (unsigned short)i;
+        a[n].next = 1;
+        ++n;
+    }
+
+    int p = 0;
+    for (; p < 9 && n > 0; ++p) {
+        unsigned char* best_row = &c->best[p * 9];
+        int m = 0;
+        int overflow = 0;
+        for (int s = 0; s < n && !overflow; ++s) {
+            for (int row = 0; row < 9; ++row) {
+                if (!row_allowed(c, &a[s], p, row)) continue;
+                CanonState ns;
+                unsigned char out[9];
+                int cmp = eval_row(c, &a[s], row, &ns, out, best_row);
+                if (cmp > 0) continue;
+                if (cmp < 0) {
+                    memcpy(best_row, out, 9);
+                    m = 0;
+                }
+                if (m == MAX_STATES) {
+                    overflow = 1;
+                    break;
+                }
+                b[m++] = ns;
+            }
+        }
+        if (overflow) {
+            //too many ties: finish every state of this level depth first
+            memset(best_row, CANON_INF, (size_t)(81 - p * 9));
+            for (int s = 0; s < n; ++s) canon_dfs(c, &a[s], p);
+            break;
+        }
+        CanonState* t = a;
+        a = b;
+        b = t;
+        n = m;
+    }
+
+    for (int i = 0; i < 81; ++i) out_form->cell[i / 9][i % 9] = c->best[i];
+    free(c);
+    free(a);
+    free(b);
+}
+
+uint64_t sudoku_canonical_hash(const SudokuBoard* puzzle) {
+    SudokuBoard form;
+    sudoku_canonical_form(puzzle, &form);
+
+    //fnv-1a
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (int i = 0; i < 81; ++i) {
+        h ^= (uint64_t)form.cell[i / 9][i % 9];
+        h *= 0x100000001b3ull;
+    }
+    return h ? h : 1;
+}
+
+//seen set
+//programs share the set file through an advisory lock on "<path>.lock" (the set file itself is
+//replaced when the table grows, so a lock on it would not outlive a grow); the set file is only
+//opened while that lock is held
+
+static void put_u32(unsigned char* p, uint32_t v) {
+    for (int i = 0; i < 4; ++i) p[i] = (unsigned char)((v >> (8 * i)) & 0xff);
+}
+
+static uint32_t get_u32(const unsigned char* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void put_u64(unsigned char* p, uint64_t v) {
+    for (int i = 0; i < 8; ++i) p[i] = (unsigned char)((v >> (8 * i)) & 0xff);
+}
+
+static uint64_t get_u64(const unsigned char* p) {
+    return (uint64_t)get_u32(p) | ((uint64_t)get_u32(p + 4) << 32);
+}
+
+//linear probing; cap is a power of 2
+static uint32_t slot_home(uint64_t hash, uint32_t cap) {
+    return (uint32_t)(hash ^ (hash >> 32)) & (cap - 1);
+}
+
+static uint32_t find_slot(const uint64_t* slots, uint32_t cap, uint64_t hash) {
+    uint32_t i = slot_home(hash, cap);
+    while (slots[i] != 0 && slots[i] != hash) i = (i + 1) & (cap - 1);
+    return i;
+}
+
+//blocks until this program holds the lock (0 = locking failed)
+static int lock_set(SudokuSeenSet* set) {
+#ifdef _WIN32
+    HANDLE h = (HANDLE)_get_osfhandle(_fileno(set->lock_file));
+    OVERLAPPED ov;
+    memset(&ov, 0, sizeof(ov));
+    return h != INVALID_HANDLE_VALUE && LockFileEx(h, LOCKFILE_EXCLUSIVE_LOCK, 0, MAXDWORD, MAXDWORD, &ov);
+#else
+    struct flock fl;
+    memset(&fl, 0, sizeof(fl));
+    fl.l_type = F_WRLCK;
+    fl.l_whence = SEEK_SET;     // start 0, length 0: the whole file
+    while (fcntl(fileno(set->lock_file), F_SETLKW, &fl) != 0) {
+        if (errno != EINTR) return 0;
+    }
+    return 1;
+#endif
+}
+
+static void unlock_set(SudokuSeenSet* set) {
+#ifdef _WIN32
+    HANDLE h = (HANDLE)_get_osfhandle(_fileno(set->lock_file));
+    OVERLAPPED ov;
+    memset(&ov, 0, sizeof(ov));
+    UnlockFileEx(h, 0, MAXDWORD, MAXDWORD, &ov);
+#else
+    struct flock fl;
+    memset(&fl, 0, sizeof(fl));
+    fl.l_type = F_UNLCK;
+    fl.l_whence = SEEK_SET;
+    fcntl(fileno(set->lock_file), F_SETLK, &fl);
+#endif
+}
+
+static SudokuResult write_header(FILE* f, const SudokuSeenSet* set) {
+    unsigned char h[SEEN_HEADER];
+    memcpy(h, "SDKH", 4);
+    put_u32(h + 4, SEEN_VERSION);
+    put_u32(h + 8, set->cap);
+    put_u32(h + 12, set->count);
+    if (fseek(f, 0, SEEK_SET) != 0 || fwrite(h, 1, sizeof(h), f) != sizeof(h)) return SUDOKU_ERR_IO;
+    return SUDOKU_OK;
+}
+
+static SudokuResult read_header(FILE* f, uint32_t* out_cap, uint32_t* out_count) {
+    unsigned char h[SEEN_HEADER];
+    if (fseek(f, 0, SEEK_SET) != 0 || fread(h, 1, sizeof(h), f) != sizeof(h)) return SUDOKU_ERR_IO;
+    if (memcmp(h, "SDKH", 4) != 0 || get_u32(h + 4) != SEEN_VERSION) return SUDOKU_ERR_IO;
+    uint32_t cap = get_u32(h + 8);
+    if (cap < SEEN_MIN_CAP || (cap & (cap - 1)) != 0) return SUDOKU_ERR_IO;
+    *out_cap = cap;
+    *out_count = get_u32(h + 12);
+    return SUDOKU_OK;
+}
+
+//loads the whole table from f (at open, and after another program grew it)
+static SudokuResult read_table(SudokuSeenSet* set, FILE* f) {
+    uint32_t cap, header_count;
+    SudokuResult r = read_header(f, &cap, &header_count);
+    if (r != SUDOKU_OK) return r;
+    uint64_t* slots = (uint64_t*)calloc(cap, sizeof(uint64_t));
+    if (!slots) return SUDOKU_ERR_NO_MEMORY;
+
+    uint32_t count = 0;
+    unsigned char b[8];
+    for (uint32_t i = 0; i < cap; ++i) {
+        if (fread(b, 1, 8, f) != 8) {
+            free(slots);
+            return SUDOKU_ERR_IO;
+        }
+        slots[i] = get_u64(b);
+        //count from the slots, the header count can be one behind after a crash
+        if (slots[i] != 0) ++count;
+    }
+    free(set->slots);
+    set->slots = slots;
+    set->cap = cap;
+    set->count = count;
+    return SUDOKU_OK;
+}
+
+//writes the whole table to a temp file and swaps it in (used on create and grow)
+static SudokuResult rewrite_file(SudokuSeenSet* set) {
+    size_t n = strlen(set->path) + 32;
+    char* tmp = (char*)malloc(n);
+    if (!tmp) return SUDOKU_ERR_NO_MEMORY;
+    if (!sudoku_temp_path(set->path, tmp, n)) {
+        free(tmp);
+        return SUDOKU_ERR_INVALID_ARG;
+    }
+
+    SudokuResult res = SUDOKU_OK;
+    FILE* f = fopen(tmp, "wb");
+    if (!f) res = SUDOKU_ERR_IO;
+    if (res == SUDOKU_OK) res = write_header(f, set);
+    for (uint32_t i = 0; res == SUDOKU_OK && i < set->cap; ++i) {
+        unsigned char b[8];
+        put_u64(b, set->slots[i]);
+        if (fwrite(b, 1, 8, f) != 8) res = SUDOKU_ERR_IO;
+    }
+    if (f && fclose(f) != 0) res = SUDOKU_ERR_IO;
+    if (f && res != SUDOKU_OK) remove(tmp);
+    if (res == SUDOKU_OK) res = sudoku_replace_file(tmp, set->path);
+    free(tmp);
+    return res;
+}
+
+SudokuResult sudoku_seen_open(SudokuSeenSet* set, const char* path) {
+    if (!set || !path) return SUDOKU_ERR_INVALID_ARG;
+    memset(set, 0, sizeof(*set));
+
+    size_t n = strlen(path);
+    set->path = (char*)malloc(n + 1);
+    char* lock_path = (char*)malloc(n + sizeof(".lock"));
+    if (!set->path || !lock_path) {
+        free(lock_path);
+        sudoku_seen_close(set);
+        return SUDOKU_ERR_NO_MEMORY;
+    }
+    memcpy(set->path, path, n + 1);
+    snprintf(lock_path, n + sizeof(".lock"), "%s.lock", path);
+    set->lock_file = fopen(lock_path, "ab");
+    free(lock_path);
+    if (!set->lock_file || !lock_set(set)) {
+        sudoku_seen_close(set);
+        return SUDOKU_ERR_IO;
+    }
+
+    SudokuResult r;
+    FILE* f = fopen(path, "rb");
+    int open_error = f ? 0 : errno;
+    if (f) {
+        r = read_table(set, f);
+        fclose(f);
+    } else if (open_error == ENOENT) {
+        //new set
+        set->cap = SEEN_MIN_CAP;
+        set->slots = (uint64_t*)calloc(set->cap, sizeof(uint64_t));
+        r = set->slots ? rewrite_file(set) : SUDOKU_ERR_NO_MEMORY;
+    } else {
+        //there is a set we cannot open (permissions, out of handles ...);
+        //starting an empty one would replace it and forget every issued puzzle
+        r = SUDOKU_ERR_IO;
+    }
+    unlock_set(set);
+    if (r != SUDOKU_OK) sudoku_seen_close(set);
+    return r;
+}
+
+void sudoku_seen_close(SudokuSeenSet* set) {
+    if (!set) return;
+    if (set->lock_file) fclose(set->lock_file);
+    free(set->slots);
+    free(set->path);
+    memset(set, 0, sizeof(*set));
+}
+
+int sudoku_seen_contains(const SudokuSeenSet* set, uint64_t hash) {
+    if (!set || !set->slots || hash == 0) return 0;
+    return set->slots[find_slot(set->slots, set->cap, hash)] == hash;
+}
+
+static SudokuResult grow(SudokuSeenSet* set) {
+    uint32_t ncap = set->cap * 2;
+    uint64_t* ns = (uint64_t*)calloc(ncap, sizeof(uint64_t));
+    if (!ns) return SUDOKU_ERR_NO_MEMORY;
+    for (uint32_t i = 0; i < set->cap; ++i) {
+        if (set->slots[i] != 0) ns[find_slot(ns, ncap, set->slots[i])] = set->slots[i];
+    }
+    free(set->slots);
+    set->slots = ns;
+    set->cap = ncap;
+    return rewrite_file(set);
+}
+
+//find_slot on the file: the slots on the probe path are read again (into set->slots too),
+//so a hash another program added after this one loaded the table is found, and its slot kept
+static SudokuResult probe_file(SudokuSeenSet* set, FILE* f, uint64_t hash, uint32_t* out_slot) {
+    uint32_t i = slot_home(hash, set->cap);
+    unsigned char b[8];
+    for (uint32_t n = 0; n < set->cap; ++n, i = (i + 1) & (set->cap - 1)) {
+        if (fseek(f, (long)(SEEN_HEADER + (size_t)i * 8), SEEK_SET) != 0 || fread(b, 1, 8, f) != 8) {
+            return SUDOKU_ERR_IO;
+        }
+        set->slots[i] = get_u64(b);
+        if (set->slots[i] == 0 || set->slots[i] == hash) {
+            *out_slot = i;
+            return SUDOKU_OK;
+        }
+    }
+    //no free slot in a table that is kept at most half full: the file is broken
+    return SUDOKU_ERR_IO;
+}
+
+//the part of sudoku_seen_add under the lock
+static SudokuResult add_locked(SudokuSeenSet* set, uint64_t hash, int* out_added) {
+    FILE* f = fopen(set->path, "r+b");
+    if (!f) return SUDOKU_ERR_IO;
+
+    uint32_t cap, count, i = 0;
+    SudokuResult r = read_header(f, &cap, &count);
+    if (r == SUDOKU_OK && cap != set->cap) r = read_table(set, f);    // another program grew it
+    else if (r == SUDOKU_OK && count > set->count) set->count = count;
+    if (r == SUDOKU_OK) r = probe_file(set, f, hash, &i);
+    if (r != SUDOKU_OK || set->slots[i] == hash) {
+        fclose(f);
+        return r;
+    }
+
+    if ((uint64_t)(set->count + 1) * 2 > set->cap) {
+        //grow from the whole file, not only the slots this program has looked at
+        r = read_table(set, f);
+        fclose(f);
+        if (r != SUDOKU_OK) return r;
+        set->slots[find_slot(set->slots, set->cap, hash)] = hash;
+        ++set->count;
+        r = grow(set);
+        if (r == SUDOKU_OK && out_added) *out_added = 1;
+        return r;
+    }
+
+    //write through: the slot, then the count
+    set->slots[i] = hash;
+    ++set->count;
+    unsigned char b[8];
+    put_u64(b, hash);
+    if (fseek(f, (long)(SEEN_HEADER + (size_t)i * 8), SEEK_SET) != 0 ||
+        fwrite(b, 1, 8, f) != 8 ||
+        write_header(f, set) != SUDOKU_OK) {
+        r = SUDOKU_ERR_IO;
+    }
+    if (fclose(f) != 0) r = SUDOKU_ERR_IO;
+    if (r == SUDOKU_OK && out_added) *out_added = 1;
+    return r;
+}
+
+SudokuResult sudoku_seen_add(SudokuSeenSet* set, uint64_t hash, int* out_added) {
+    if (out_added) *out_added = 0;
+    if (!set || !set->slots || !set->lock_file || hash == 0) return SUDOKU_ERR_INVALID_ARG;
+    //hashes are never removed, so one this program knows is in the file too
+    if (sudoku_seen_contains(set, hash)) return SUDOKU_OK;
+
+    if (!lock_set(set)) return SUDOKU_ERR_IO;
+    SudokuResult r = add_locked(set, hash, out_added);
+    unlock_set(set);
+    return r;
+}
@@ -0,0 +1,60 @@
+// sudoku_dedupe.h - canonical puzzle hashes and a persistent "already issued" set
+
+//two puzzles are the same puzzle in disguise if one becomes the other by relabeling digits,
+//swapping rows inside a band, swapping bands, the same for columns, or transposing
+//sudoku_canonical_form() picks one fixed representative of all those variants
+//(the smallest one in reading order), so isomorphic puzzles get the same form and hash
+
+//the seen set is an open addressing hash table of canonical hashes kept in a file:
+//load it at start, check candidates before grading/rendering, add what gets issued
+//every add is written to the file right away, so a crashed run does not forget anything
+//separate programs can share one file: open and add take an advisory lock on "<path>.lock",
+//and an add reads the file again under it; threads of one program still lock around the set
+//(the file lock belongs to the process)
+
+//file layout (little endian): "SDKH", version, capacity (power of 2), count, then capacity u64 slots
+//0 = empty slot (hashes are never 0)
+
+#ifndef SUDOKU_DEDUPE_H
+#define SUDOKU_DEDUPE_H
+
+#include "sudoku_module.h"
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct SudokuSeenSet {
+    uint64_t* slots;
+    uint32_t cap;
+    uint32_t count;
+    FILE* lock_file;        // "<path>.lock"
+    char* path;
+} SudokuSeenSet;
+
+//smallest variant of the puzzle (0 cells stay 0 and sort before digits)
+//~0.1 ms for normal puzzles (nearly empty boards take much longer), no global state
+void sudoku_canonical_form(const SudokuBoard* puzzle, SudokuBoard* out_form);
+
+//64 bit hash of the canonical form, never 0
+uint64_t sudoku_canonical_hash(const SudokuBoard* puzzle);
+
+//opens the set file, creates an empty one if it does not exist (any other open error is SUDOKU_ERR_IO)
+SudokuResult sudoku_seen_open(SudokuSeenSet* set, const char* path);
+void sudoku_seen_close(SudokuSeenSet* set);
+
+//looks in memory only: the set as loaded, plus what this program added (or saw while adding)
+int sudoku_seen_contains(const SudokuSeenSet* set, uint64_t hash);
+
+//adds the hash (no-op if it is there already); grows the table at half full
+//out_added (optional) = 1 if it was new, 0 if this or another program had added it before;
+//that is the exact check when several programs share the file
+SudokuResult sudoku_seen_add(SudokuSeenSet* set, uint64_t hash, int* out_added);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,426 @@
+// sudoku_grade.c - technique based grader
+
+#include "sudoku_grade.h"
+
+#include <string.h>
+
+//cost of one step with each technique (same order as SudokuTechnique)
+static const int k_tech_cost[SUDOKU_TECH_COUNT] = {1, 2, 5, 8, 12, 20, 50};
+
+static const char* k_tech_name[SUDOKU_TECH_COUNT] = {
+    "hidden-single",
+    "naked-single",
+    "locked-candidates",
+    "naked-pair",
+    "hidden-pair",
+    "x-wing",
+    "guess"
+};
+
+//27 units: rows 0..8, cols 9..17, boxes 18..26; k = 0..8 inside the unit
+static int unit_cell(int u, int k) {
+    if (u < 9) return u * 9 + k;
+    if (u < 18) return k * 9 + (u - 9);
+    int b = u - 18;
+    return ((b / 3) * 3 + k / 3) * 9 + (b % 3) * 3 + k % 3;
+}
+
+static int box_index(int idx) {
+    return ((idx / 9) / 3) * 3 + (idx % 9) / 3;
+}
+
+static int bits9(unsigned int m) {
+    int n = 0;
+    while (m) {
+        m &= m - 1;
+        ++n;
+    }
+    return n;
+}
+
+static int lowest_value(unsigned int m) {
+    for (int v = 1; v <= 9; ++v) {
+        if (m & (1u << (v - 1))) return v;
+    }
+    return 0;
+}
+
+typedef struct GradeState {
+    int value[81];
+    unsigned short cand[81]; // candidate mask for empty cells, 0 for filled ones
+    int solution[81];        // only used for guesses
+    SudokuGrade* g;
+    SudokuTrace* trace;      // optional
+} GradeState;
+
+//cell = placed cell (or SUDOKU_TRACE_NONE for eliminations), digit = placed/eliminated digit,
+//info = unit (0..26) the step is about, or SUDOKU_TRACE_NONE
+static void use_technique(GradeState* st, SudokuTechnique t, int cell, int digit, int info) {
+    st->g->score += k_tech_cost[t];
+    st->g->uses[t] += 1;
+    st->g->techniques |= 1u << t;
+    if ((int)t > st->g->hardest) st->g->hardest = (int)t;
+
+    SudokuTrace* tr = st->trace;
+    if (tr && tr->len + 3 <= (int)sizeof(tr->bytes)) {
+        tr->bytes[tr->len++] = (unsigned char)(((int)t << 4) | digit);
+        tr->bytes[tr->len++] = (unsigned char)cell;
+        tr->bytes[tr->len++] = (unsigned char)info;
+    }
+}
+
+static void place(GradeState* st, int idx, int v) {
+    unsigned short keep = (unsigned short)~(1u << (v - 1));
+    int r = idx / 9, c = idx % 9, b = box_index(idx);
+    st->value[idx] = v;
+    st->cand[idx] = 0;
+    for (int k = 0; k < 9; ++k) {
+        st->cand[unit_cell(r, k)] &= keep;
+        st->cand[unit_cell(9 + c, k)] &= keep;
+        st->cand[unit_cell(18 + b, k)] &= keep;
+    }
+}
+
+//removes `mask` from a cell; returns the candidates that were removed (0 = nothing changed)
+static unsigned int eliminate(GradeState* st, int idx, unsigned int mask) {
+    unsigned int removed = st->cand[idx] & mask;
+    st->cand[idx] &= (unsigned short)~mask;
+    return removed;
+}
+
+static int try_hidden_single(GradeState* st) {
+    for (int u = 0; u < 27; ++u) {
+        for (int v = 1; v <= 9; ++v) {
+            unsigned int bit = 1u << (v - 1);
+            int where = -1, n = 0;
+            for (int k = 0; k < 9; ++k) {
+                int idx = unit_cell(u, k);
+                if (st->cand[idx] & bit) {
+                    where = idx;
+                    ++n;
+                }
+            }
+            if (n == 1) {
+                place(st, where, v);
+                use_technique(st, SUDOKU_TECH_HIDDEN_SINGLE, where, v, u);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+static int try_naked_single(GradeState* st) {
+    for (int idx = 0; idx < 81; ++idx) {
+        if (st->value[idx] == 0 && bits9(st->cand[idx]) == 1) {
+            int v = lowest_value(st->cand[idx]);
+            place(st, idx, v);
+            use_technique(st, SUDOKU_TECH_NAKED_SINGLE, idx, v, SUDOKU_TRACE_NONE);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+//pointing: a digit inside a box only fits on one row/col -> remove it from the rest of that line
+//claiming: a digit inside a row/col only fits in one box -> remove it from the rest of that box
+static int try_locked_candidates(GradeState* st) {
+    for (int v = 1; v <= 9; ++v) {
+        unsigned int bit = 1u << (v - 1);
+
+        for (int b = 0; b < 9; ++b) {
+            int rows = 0, cols = 0, n = 0, first = -1;
+            for (int k = 0; k < 9; ++k) {
+                int idx = unit_cell(18 + b, k);
+                if (!(st->cand[idx] & bit)) continue;
+                rows |= 1 << (idx / 9);
+                cols |= 1 << (idx % 9);
+                if (first < 0) first = idx;
+                ++n;
+            }
+            if (n < 2) continue;
+
+            unsigned int changed = 0;
+            if (bits9((unsigned int)rows) == 1) {
+                for (int k = 0; k < 9; ++k) {
+                    int idx = unit_cell(first / 9, k);
+                    if (box_index(idx) != b) changed |= eliminate(st, idx, bit);
+                }
+            }
+            if (bits9((unsigned int)cols) == 1) {
+                for (int k = 0; k < 9; ++k) {
+                    int idx = unit_cell(9 + first % 9, k);
+                    if (box_index(idx) != b) changed |= eliminate(st, idx, bit);
+                }
+            }
+            if (changed) {
+                use_technique(st, SUDOKU_TECH_LOCKED_CANDIDATES, SUDOKU_TRACE_NONE, v, 18 + b);
+                return 1;
+            }
+        }
+
+        for (int u = 0; u < 18; ++u) {
+            int boxes = 0, b = -1;
+            for (int k = 0; k < 9; ++k) {
+                int idx = unit_cell(u, k);
+                if (!(st->cand[idx] & bit)) continue;
+                boxes |= 1 << box_index(idx);
+                b = box_index(idx);
+            }
+            if (b < 0 || bits9((unsigned int)boxes) != 1) continue;
+
+            unsigned int changed = 0;
+            for (int k = 0; k < 9; ++k) {
+                int idx = unit_cell(18 + b, k);
+                int on_line = (u < 9) ? (idx / 9 == u) : (idx % 9 == u - 9);
+                if (!on_line) changed |= eliminate(st, idx, bit);
+            }
+            if (changed) {
+                use_technique(st, SUDOKU_TECH_LOCKED_CANDIDATES, SUDOKU_TRACE_NONE, v, u);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+static int try_naked_pair(GradeState* st) {
+    for (int u = 0; u < 27; ++u) {
+        for (int a = 0; a < 9; ++a) {
+            int ia = unit_cell(u, a);
+            unsigned int m = st->cand[ia];
+            if (bits9(m) != 2) continue;
+            for (int b = a + 1; b < 9; ++b) {
+                int ib = unit_cell(u, b);
+                if (st->cand[ib] != m) continue;
+
+                unsigned int changed = 0;
+                for (int k = 0; k < 9; ++k) {
+                    int idx = unit_cell(u, k);
+                    if (idx != ia && idx != ib) changed |= eliminate(st, idx, m);
+                }
+                if (changed) {
+                    use_technique(st, SUDOKU_TECH_NAKED_PAIR, SUDOKU_TRACE_NONE, lowest_value(changed), u);
+                    return 1;
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+static int try_hidden_pair(GradeState* st) {
+    for (int u = 0; u < 27; ++u) {
+        //where[v] = bitmask of unit positions (k) that still allow v
+        int where[10] = {0};
+        for (int k = 0; k < 9; ++k) {
+            unsigned int m = st->cand[unit_cell(u, k)];
+            for (int v = 1; v <= 9; ++v) {
+                if (m & (1u << (v - 1))) where[v] |= 1 << k;
+            }
+        }
+        for (int v1 = 1; v1 <= 9; ++v1) {
+            if (bits9((unsigned int)where[v1]) != 2) continue;
+            for (int v2 = v1 + 1; v2 <= 9; ++v2) {
+                if (where[v2] != where[v1]) continue;
+
+                unsigned int keep = (1u << (v1 - 1)) | (1u << (v2 - 1));
+                unsigned int changed = 0;
+                for (int k = 0; k < 9; ++k) {
+                    if (where[v1] & (1 << k)) {
+                        changed |= eliminate(st, unit_cell(u, k), ~keep & 0x1FFu);
+                    }
+                }
+                if (changed) {
+                    //the trace digit is one the pair cells lost, not one of the pair
+                    use_technique(st, SUDOKU_TECH_HIDDEN_PAIR, SUDOKU_TRACE_NONE, lowest_value(changed), u);
+                    return 1;
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+//a digit fits in exactly the same 2 columns on 2 rows (or 2 rows on 2 columns):
+//it must be in those corners, so it goes away from the rest of those columns (rows)
+static int try_x_wing(GradeState* st) {
+    for (int v = 1; v <= 9; ++v) {
+        unsigned int bit = 1u << (v - 1);
+        for (int by_col = 0; by_col < 2; ++by_col) {
+            int base = by_col ? 9 : 0;
+            int other = by_col ? 0 : 9;
+            int line[9];
+            for (int i = 0; i < 9; ++i) {
+                line[i] = 0;
+                for (int k = 0; k < 9; ++k) {
+                    if (st->cand[unit_cell(base + i, k)] & bit) line[i] |= 1 << k;
+                }
+            }
+            for (int i = 0; i < 9; ++i) {
+                if (bits9((unsigned int)line[i]) != 2) continue;
+                for (int j = i + 1; j < 9; ++j) {
+                    if (line[j] != line[i]) continue;
+
+                    unsigned int changed = 0;
+                    for (int k = 0; k < 9; ++k) {
+                        if (!(line[i] & (1 << k))) continue;
+                        for (int t = 0; t < 9; ++t) {
+                            if (t == i || t == j) continue;
+                            changed |= eliminate(st, unit_cell(other + k, t), bit);
+                        }
+                    }
+                    if (changed) {
+                        use_technique(st, SUDOKU_TECH_X_WING, SUDOKU_TRACE_NONE, v, base + i);
+                        return 1;
+                    }
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+//stuck: fill the cell with the fewest candidates from the known solution
+static void guess(GradeState* st) {
+    int best = -1, best_n = 10;
+    for (int idx = 0; idx < 81; ++idx) {
+        if (st->value[idx] != 0) continue;
+        int n = bits9(st->cand[idx]);
+        if (n < best_n) {
+            best = idx;
+            best_n = n;
+        }
+    }
+    place(st, best, st->solution[best]);
+    use_technique(st, SUDOKU_TECH_GUESS, best, st->solution[best], SUDOKU_TRACE_NONE);
+}
+
+static int all_filled(const GradeState* st) {
+    for (int idx = 0; idx < 81; ++idx) {
+        if (st->value[idx] == 0) return 0;
+    }
+    return 1;
+}
+
+SudokuResult sudoku_grade(const SudokuBoard* puzzle, SudokuGrade* out_grade) {
+    return sudoku_grade_trace(puzzle, NULL, out_grade, NULL);
+}
+
+SudokuResult sudoku_grade_trace(
+    const SudokuBoard* puzzle,
+    const SudokuBoard* solution,
+    SudokuGrade* out_grade,
+    SudokuTrace* out_trace
+) {
+    if (!puzzle || !out_grade) return SUDOKU_ERR_INVALID_ARG;
+
+    SudokuBoard solved;
+    if (solution) {
+        //guesses must land on the solution the page checks against, so it has to be a full
+        //valid grid (a 0 or 10 there would be placed as a digit) that keeps the givens
+        if (!sudoku_is_valid_partial(solution)) return SUDOKU_ERR_INVALID_ARG;
+        for (int idx = 0; idx < 81; ++idx) {
+            int given = puzzle->cell[idx / 9][idx % 9];
+            if (solution->cell[idx / 9][idx % 9] == 0) return SUDOKU_ERR_INVALID_ARG;
+            if (given != 0 && given != solution->cell[idx / 9][idx % 9]) return SUDOKU_ERR_INVALID_ARG;
+        }
+        solved = *solution;
+    } else if (sudoku_count_solutions(puzzle, 1, &solved) != 1) {
+        return SUDOKU_ERR_UNSOLVABLE;
+    }
+
+    memset(out_grade, 0, sizeof(*out_grade));
+    if (out_trace) out_trace->len = 0;
+
+    GradeState st;
+    st.g = out_grade;
+    st.trace = out_trace;
+    for (int idx = 0; idx < 81; ++idx) {
+        st.value[idx] = 0;
+        st.cand[idx] = 0x1FF;
+        st.solution[idx] = solved.cell[idx / 9][idx % 9];
+    }
+    for (int idx = 0; idx < 81; ++idx) {
+        int v = puzzle->cell[idx / 9][idx % 9];
+        if (v != 0) place(&st, idx, v);
+    }
+
+    while (!all_filled(&st)) {
+        if (try_hidden_single(&st)) continue;
+        if (try_naked_single(&st)) continue;
+        if (try_locked_candidates(&st)) continue;
+        if (try_naked_pair(&st)) continue;
+        if (try_hidden_pair(&st)) continue;
+        if (try_x_wing(&st)) continue;
+        guess(&st);
+    }
+    return SUDOKU_OK;
+}
+
+//no libm needed for one square root
+static double sqrt_approx(double x) {
+    if (x <= 0.0) return 0.0;
+    double r = x > 1.0 ? x : 1.0;
+    for (int i = 0; i < 20; ++i) r = 0.5 * (r + x / r);
+    return r;
+}
+
+//two linear fits (no guessing needed / guessing needed), trained on 1500 unique
+//random puzzles (35-64 holes) + ~540 mined hard ones, checked on others:
+//random puzzles: correlation 0.60, average error ~45 points
+//mined puzzles (score 100-700): correlation 0.69, average error ~90 points
+int sudoku_estimate_score(const SudokuSolveStats* stats) {
+    if (!stats) return 0;
+    double est;
+    if (stats->branches == 0) {
+        //pure propagation: about one point per empty cell
+        est = -0.54 + 1.0125 * stats->empty_cells;
+    } else {
+        double extra_nodes = (double)(stats->nodes - stats->empty_cells);
+        est = 407.0
+            - 6.842 * stats->empty_cells
+            - 9.891 * stats->start_singles
+            - 60.81 * sqrt_approx((double)stats->branches)
+            + 12.77 * stats->max_depth
+            + 19.27 * sqrt_approx(extra_nodes);
+    }
+
+    //every empty cell costs at least 1 in the real grade
+    if (est < stats->empty_cells) est = stats->empty_cells;
+    return (int)(est + 0.5);
+}
+
+SudokuDifficulty sudoku_grade_difficulty(const SudokuGrade* grade) {
+    if (!grade) return SUDOKU_DIFFICULTY_MEDIUM;
+    if (grade->hardest <= SUDOKU_TECH_NAKED_SINGLE) return SUDOKU_DIFFICULTY_EASY;
+    if (grade->hardest <= SUDOKU_TECH_HIDDEN_PAIR) return SUDOKU_DIFFICULTY_MEDIUM;
+    return SUDOKU_DIFFICULTY_HARD;
+}
+
+static const char k_base64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+int sudoku_trace_to_base64(const SudokuTrace* trace, char* out, size_t out_size) {
+    if (!trace || !out) return 0;
+    size_t need = (size_t)((trace->len + 2) / 3) * 4 + 1;
+    if (out_size < need) return 0;
+
+    size_t o = 0;
+    for (int i = 0; i < trace->len; i += 3) {
+        //steps are 3 bytes, so the trace never needs '=' padding
+        unsigned int v = ((unsigned int)trace->bytes[i] << 16)
+            | ((unsigned int)trace->bytes[i + 1] << 8)
+            | (unsigned int)trace->bytes[i + 2];
+        out[o++] = k_base64[(v >> 18) & 63];
+        out[o++] = k_base64[(v >> 12) & 63];
+        out[o++] = k_base64[(v >> 6) & 63];
+        out[o++] = k_base64[v & 63];
+    }
+    out[o] = '\0';
+    return 1;
+}
+
+const char* sudoku_technique_name(SudokuTechnique technique) {
+    if ((int)technique < 0 || technique >= SUDOKU_TECH_COUNT) return "unknown";
+    return k_tech_name[technique];
+}
@@ -0,0 +1,86 @@
+// sudoku_grade.h - difficulty grading by solving techniques
+
+//the grader solves a puzzle the way a person would: it always applies the easiest
+//technique that makes progress and adds up a cost for every step
+//harder techniques cost more, so the total score says how hard the puzzle is
+
+#ifndef SUDOKU_GRADE_H
+#define SUDOKU_GRADE_H
+
+#include "sudoku_module.h"
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//ordered from easiest to hardest
+typedef enum SudokuTechnique {
+    SUDOKU_TECH_HIDDEN_SINGLE = 0,
+    SUDOKU_TECH_NAKED_SINGLE = 1,
+    SUDOKU_TECH_LOCKED_CANDIDATES = 2, // pointing + claiming
+    SUDOKU_TECH_NAKED_PAIR = 3,
+    SUDOKU_TECH_HIDDEN_PAIR = 4,
+    SUDOKU_TECH_X_WING = 5,
+    SUDOKU_TECH_GUESS = 6,             // nothing above worked, trial and error needed
+    SUDOKU_TECH_COUNT = 7
+} SudokuTechnique;
+
+typedef struct SudokuGrade {
+    int score;                   // sum of step costs
+    int hardest;                 // hardest SudokuTechnique that was needed
+    unsigned int techniques;     // bit t set = technique t was used at least once
+    int uses[SUDOKU_TECH_COUNT]; // how many steps used each technique
+} SudokuGrade;
+
+//solve trace: 3 bytes per grading step, in the order the grader took them
+//  byte 0: technique << 4 | digit (placed digit, or the digit the step removed)
+//  byte 1: placed cell 0..80 (row-major), SUDOKU_TRACE_NONE for steps that only remove candidates
+//  byte 2: unit the step is about (0..8 rows, 9..17 cols, 18..26 boxes), or SUDOKU_TRACE_NONE
+//a typical puzzle is 50-70 steps, so ~150-200 bytes (~200-270 chars as base64)
+#define SUDOKU_TRACE_NONE 255
+#define SUDOKU_TRACE_MAX_STEPS 729
+
+typedef struct SudokuTrace {
+    unsigned char bytes[SUDOKU_TRACE_MAX_STEPS * 3];
+    int len;
+} SudokuTrace;
+
+//grades a puzzle (0 = empty); the puzzle should have exactly one solution
+//(for a non-unique puzzle the guesses follow the first solution the solver finds)
+//returns SUDOKU_ERR_UNSOLVABLE if there is no solution
+//like sudoku_count_solutions() it has no global state, so threads can grade in parallel
+SudokuResult sudoku_grade(const SudokuBoard* puzzle, SudokuGrade* out_grade);
+
+//same as sudoku_grade(), and records every step into out_trace (optional) in the same pass
+//solution (optional): the solution guesses should follow, eg. the one embedded in the page
+//(matters for puzzles that are not unique); SUDOKU_ERR_INVALID_ARG if it is not a full valid
+//grid or does not keep the givens
+SudokuResult sudoku_grade_trace(
+    const SudokuBoard* puzzle,
+    const SudokuBoard* solution,
+    SudokuGrade* out_grade,
+    SudokuTrace* out_trace
+);
+
+//base64 of the trace for the page (data-trace="..."); out needs len / 3 * 4 + 1 chars
+//returns 0 if out is too small
+int sudoku_trace_to_base64(const SudokuTrace* trace, char* out, size_t out_size);
+
+//cheap estimate of SudokuGrade.score from the statistics of the uniqueness check
+//(sudoku_count_solutions_stats with limit 2), so it adds no extra solving
+//good enough to throw away obvious misses before running sudoku_grade() on the rest
+int sudoku_estimate_score(const SudokuSolveStats* stats);
+
+//maps a grade to the 3 site difficulties (easy = singles only, hard = x-wing or guessing)
+SudokuDifficulty sudoku_grade_difficulty(const SudokuGrade* grade);
+
+//short name for logs and result files, eg "x-wing"
+const char* sudoku_technique_name(SudokuTechnique technique);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,307 @@
+// sudoku_log.c - crash safe ingestion log
+
+#include "sudoku_log.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define LOG_VERSION 1
+#define LOG_HEADER 24
+#define FRAME_HEADER 24
+#define MAX_FRAME_ENTRIES (1 << 20)
+
+static void put_u32(unsigned char* p, uint32_t v) {
+    for (int i = 0; i < 4; ++i) p[i] = (unsigned char)((v >> (8 * i)) & 0xff);
+}
+
+static uint32_t get_u32(const unsigned char* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+//crc32 (the zip/png one), 4 bits at a time so the table stays small
+static uint32_t crc32_update(uint32_t crc, const unsigned char* p, size_t n) {
+    static const uint32_t nibble[16] = {
+        0x00000000u, 0x1db71064u, 0x3b6e20c8u, 0x26d930acu, 0x76dc4190u, 0x6b6b51f4u, 0x4db26158u, 0x5005713cu,
+        0xedb88320u, 0xf00f9344u, 0xd6d6a3e8u, 0xcb61b38cu, 0x9b64c2b0u, 0x86d3d2d4u, 0xa00ae278u, 0xbdbdf21cu
+    };
+    crc = ~crc;
+    for (size_t i = 0; i < n; ++i) {
+        crc ^= p[i];
+        crc = (crc >> 4) ^ nibble[crc & 15];
+        crc = (crc >> 4) ^ nibble[crc & 15];
+    }
+    return ~crc;
+}
+
+static char* temp_path(const char* path) {
+    size_t n = strlen(path) + 32;
+    char* tmp = (char*)malloc(n);
+    if (tmp && !sudoku_temp_path(path, tmp, n)) {
+        free(tmp);
+        tmp = NULL;
+    }
+    return tmp;
+}
+
+//empty log starting after frame base_seq, written next to the old one and renamed over it
+static SudokuResult write_empty_log(const char* path, uint32_t base_seq, uint64_t cursor) {
+    char* tmp = temp_path(path);
+    if (!tmp) return SUDOKU_ERR_NO_MEMORY;
+
+    unsigned char h[LOG_HEADER];
+    memset(h, 0, sizeof(h));
+    memcpy(h, "SDKL", 4);
+    put_u32(h + 4, LOG_VERSION);
+    put_u32(h + 8, base_seq);
+    put_u32(h + 16, (uint32_t)(cursor & 0xffffffffu));
+    put_u32(h + 20, (uint32_t)(cursor >> 32));
+
+    SudokuResult res = SUDOKU_OK;
+    FILE* f = fopen(tmp, "wb");
+    if (!f) {
+        res = SUDOKU_ERR_IO;
+    } else {
+        if (fwrite(h, 1, sizeof(h), f) != sizeof(h) || sudoku_sync_file(f) != SUDOKU_OK) res = SUDOKU_ERR_IO;
+        if (fclose(f) != 0) res = SUDOKU_ERR_IO;
+        if (res != SUDOKU_OK) remove(tmp);
+    }
+    if (res == SUDOKU_OK) res = sudoku_replace_file(tmp, path);
+    if (res == SUDOKU_OK) res = sudoku_sync_dir_of(path);
+    free(tmp);
+    return res;
+}
+
+static SudokuResult push_entry(SudokuStoreEntry** entries, int* count, int* cap, const SudokuStoreEntry* e) {
+    if (*count == *cap) {
+        int ncap = *cap ? *cap * 2 : 1024;
+        SudokuStoreEntry* ne = (SudokuStoreEntry*)realloc(*entries, (size_t)ncap * sizeof(SudokuStoreEntry));
+        if (!ne) return SUDOKU_ERR_NO_MEMORY;
+        *entries = ne;
+        *cap = ncap;
+    }
+    (*entries)[(*count)++] = *e;
+    return SUDOKU_OK;
+}
+
+//walks the frames after the header and stops at the first one that does not check out
+//updates seq / cursor / committed / end; entries of frames after skip_seq go to `entries` (optional)
+static SudokuResult read_frames(SudokuLog* log, uint32_t skip_seq, SudokuStoreEntry** entries, int* count, int* cap) {
+    log->seq = log->base_seq;
+    log->cursor = log->base_cursor;
+    log->committed = 0;
+    log->end = LOG_HEADER;
+    if (fseek(log->file, LOG_HEADER, SEEK_SET) != 0) return SUDOKU_ERR_IO;
+
+    unsigned char* payload = NULL;
+    size_t payload_cap = 0;
+    SudokuResult res = SUDOKU_OK;
+    for (;;) {
+        unsigned char h[FRAME_HEADER];
+        if (fread(h, 1, sizeof(h), log->file) != sizeof(h)) break;
+        uint32_t seq = get_u32(h + 4);
+        uint32_t n = get_u32(h + 8);
+        if (memcmp(h, "SDKB", 4) != 0 || seq != log->seq + 1 || n == 0 || n > MAX_FRAME_ENTRIES) break;
+
+        size_t bytes = (size_t)n * SUDOKU_STORE_RECORD_SIZE;
+        if (bytes > payload_cap) {
+            unsigned char* np = (unsigned char*)realloc(payload, bytes);
+            if (!np) {
+                res = SUDOKU_ERR_NO_MEMORY;
+                break;
+            }
+            payload = np;
+            payload_cap = bytes;
+        }
+        if (fread(payload, 1, bytes, log->file) != bytes) break;
+        uint32_t crc = crc32_update(0, h + 4, 16);
+        crc = crc32_update(crc, payload, bytes);
+        if (crc != get_u32(h + 20)) break;
+
+        if (entries && seq > skip_seq) {
+            for (uint32_t i = 0; i < n && res == SUDOKU_OK; ++i) {
+                SudokuStoreEntry e;
+                sudoku_store_unpack(payload + (size_t)i * SUDOKU_STORE_RECORD_SIZE, &e);
+                res = push_entry(entries, count, cap, &e);
+            }
+            if (res != SUDOKU_OK) break;
+        }
+        log->seq = seq;
+        log->cursor = (uint64_t)get_u32(h + 12) | ((uint64_t)get_u32(h + 16) << 32);
+        log->committed += n;
+        log->end += (long)(FRAME_HEADER + bytes);
+    }
+    free(payload);
+    return res;
+}
+
+//last log frame the store at store_path contains (0 if there is no store yet)
+static SudokuResult store_log_seq(const char* store_path, uint32_t* out_seq) {
+    *out_seq = 0;
+    FILE* probe = store_path ? fopen(store_path, "rb") : NULL;
+    if (!probe) return SUDOKU_OK;
+    fclose(probe);
+    SudokuStore store;
+    SudokuResult res = sudoku_store_open(&store, store_path);
+    if (res != SUDOKU_OK) return res;
+    *out_seq = store.log_seq;
+    sudoku_store_close(&store);
+    return SUDOKU_OK;
+}
+
+SudokuResult sudoku_log_open(SudokuLog* log, const char* path, const char* store_path, int batch_size) {
+    if (!log || !path || batch_size < 1 || batch_size > MAX_FRAME_ENTRIES) return SUDOKU_ERR_INVALID_ARG;
+    memset(log, 0, sizeof(*log));
+    log->batch_size = batch_size;
+
+    size_t n = strlen(path);
+    log->path = (char*)malloc(n + 1);
+    log->pending = (SudokuStoreEntry*)malloc((size_t)batch_size * sizeof(SudokuStoreEntry));
+    if (!log->path || !log->pending) {
+        sudoku_log_close(log);
+        return SUDOKU_ERR_NO_MEMORY;
+    }
+    memcpy(log->path, path, n + 1);
+
+    log->file = fopen(path, "r+b");
+    if (!log->file) {
+        //a new log numbers its frames on from the last one the store has; starting at 1 again
+        //would make compaction take every new frame for one it already folded in
+        uint32_t base_seq = 0;
+        SudokuResult r = store_log_seq(store_path, &base_seq);
+        if (r == SUDOKU_OK && write_empty_log(path, base_seq, 0) != SUDOKU_OK) r = SUDOKU_ERR_IO;
+        if (r != SUDOKU_OK) {
+            sudoku_log_close(log);
+            return r;
+        }
+        log->file = fopen(path, "r+b");
+    }
+
+    unsigned char h[LOG_HEADER];
+    if (!log->file || fread(h, 1, sizeof(h), log->file) != sizeof(h) ||
+        memcmp(h, "SDKL", 4) != 0 || get_u32(h + 4) != LOG_VERSION) {
+        sudoku_log_close(log);
+        return SUDOKU_ERR_IO;
+    }
+    log->base_seq = get_u32(h + 8);
+    log->base_cursor = (uint64_t)get_u32(h + 16) | ((uint64_t)get_u32(h + 20) << 32);
+
+    //a torn frame at the end is simply overwritten by the next commit
+    SudokuResult r = read_frames(log, 0, NULL, NULL, NULL);
+    if (r != SUDOKU_OK) sudoku_log_close(log);
+    return r;
+}
+
+SudokuResult sudoku_log_append(SudokuLog* log, const SudokuStoreEntry* entry, uint64_t cursor) {
+    if (!log || !log->file || !entry) return SUDOKU_ERR_INVALID_ARG;
+    //a full batch is still here if its commit failed; retry before taking more
+    if (log->pending_count == log->batch_size) {
+        SudokuResult r = sudoku_log_commit(log);
+        if (r != SUDOKU_OK) return r;
+    }
+    log->pending[log->pending_count++] = *entry;
+    log->pending_cursor = cursor;
+    if (log->pending_count == log->batch_size) return sudoku_log_commit(log);
+    return SUDOKU_OK;
+}
+
+SudokuResult sudoku_log_commit(SudokuLog* log) {
+    if (!log || !log->file) return SUDOKU_ERR_INVALID_ARG;
+    if (log->pending_count == 0) return SUDOKU_OK;
+
+    size_t bytes = (size_t)log->pending_count * SUDOKU_STORE_RECORD_SIZE;
+    unsigned char* frame = (unsigned char*)malloc(FRAME_HEADER + bytes);
+    if (!frame) return SUDOKU_ERR_NO_MEMORY;
+
+    uint32_t seq = log->seq + 1;
+    memcpy(frame, "SDKB", 4);
+    put_u32(frame + 4, seq);
+    put_u32(frame + 8, (uint32_t)log->pending_count);
+    put_u32(frame + 12, (uint32_t)(log->pending_cursor & 0xffffffffu));
+    put_u32(frame + 16, (uint32_t)(log->pending_cursor >> 32));
+    for (int i = 0; i < log->pending_count; ++i) {
+        sudoku_store_pack(&log->pending[i], frame + FRAME_HEADER + (size_t)i * SUDOKU_STORE_RECORD_SIZE);
+    }
+    uint32_t crc = crc32_update(0, frame + 4, 16);
+    put_u32(frame + 20, crc32_update(crc, frame + FRAME_HEADER, bytes));
+
+    //one write and one sync for the whole batch
+    SudokuResult res = SUDOKU_OK;
+    if (fseek(log->file, log->end, SEEK_SET) != 0 ||
+        fwrite(frame, 1, FRAME_HEADER + bytes, log->file) != FRAME_HEADER + bytes ||
+        sudoku_sync_file(log->file) != SUDOKU_OK) {
+        res = SUDOKU_ERR_IO;
+    }
+    free(frame);
+    if (res != SUDOKU_OK) return res;
+
+    log->seq = seq;
+    log->cursor = log->pending_cursor;
+    log->committed += log->pending_count;
+    log->end += (long)(FRAME_HEADER + bytes);
+    log->pending_count = 0;
+    return SUDOKU_OK;
+}
+
+SudokuResult sudoku_log_close(SudokuLog* log) {
+    if (!log) return SUDOKU_ERR_INVALID_ARG;
+    SudokuResult res = SUDOKU_OK;
+    if (log->file) {
+        res = sudoku_log_commit(log);
+        if (fclose(log->file) != 0) res = SUDOKU_ERR_IO;
+    }
+    free(log->path);
+    free(log->pending);
+    memset(log, 0, sizeof(*log));
+    return res;
+}
+
+SudokuResult sudoku_log_compact(SudokuLog* log, const char* store_path) {
+    if (!log || !log->file || !store_path) return SUDOKU_ERR_INVALID_ARG;
+    SudokuResult res = sudoku_log_commit(log);
+    if (res != SUDOKU_OK) return res;
+
+    SudokuStoreEntry* entries = NULL;
+    int count = 0, cap = 0;
+    uint32_t store_seq = 0;
+
+    //no store yet = empty store
+    FILE* probe = fopen(store_path, "rb");
+    if (probe) {
+        fclose(probe);
+        SudokuStore store;
+        res = sudoku_store_open(&store, store_path);
+        if (res != SUDOKU_OK) return res;
+        store_seq = store.log_seq;
+        //a log behind its store was not started from it (see sudoku_log_open); its frames would
+        //all be skipped as already compacted, so refuse instead of dropping them
+        if (log->seq < store_seq) {
+            sudoku_store_close(&store);
+            return SUDOKU_ERR_INVALID_ARG;
+        }
+        for (int id = 0; id < store.count && res == SUDOKU_OK; ++id) {
+            SudokuStoreEntry e;
+            sudoku_store_get(&store, id, &e);
+            res = push_entry(&entries, &count, &cap, &e);
+        }
+        sudoku_store_close(&store);
+    }
+
+    //frames the store already has (crash between writing the store and resetting the log) are skipped
+    if (res == SUDOKU_OK) res = read_frames(log, store_seq, &entries, &count, &cap);
+    if (res == SUDOKU_OK && log->seq > store_seq) res = sudoku_store_write_ex(store_path, entries, count, log->seq);
+    free(entries);
+    if (res != SUDOKU_OK) return res;
+
+    //start an empty log after the last compacted frame
+    fclose(log->file);
+    log->file = NULL;
+    res = write_empty_log(log->path, log->seq, log->cursor);
+    if (res != SUDOKU_OK) return res;
+    log->file = fopen(log->path, "r+b");
+    if (!log->file) return SUDOKU_ERR_IO;
+    log->base_seq = log->seq;
+    log->base_cursor = log->cursor;
+    log->committed = 0;
+    log->end = LOG_HEADER;
+    return SUDOKU_OK;
+}
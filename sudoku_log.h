@@ -0,0 +1,72 @@
+// sudoku_log.h - crash safe ingestion log for puzzle stores
+
+//long batch jobs append their graded puzzles here instead of keeping them in memory
+//until the end. entries are collected into batches, and every full batch is written as one
+//checksummed frame (group commit: one write + flush per batch, not per puzzle)
+//after a crash, opening the log keeps every complete frame and drops a torn last one,
+//so at most one batch is lost; `cursor` tells the job where to resume its input
+
+//sudoku_log_compact() folds the log into an indexed store (sudoku_store.h) and starts
+//an empty log. the store remembers the last frame it contains, so a crash in the middle
+//of compaction never adds a batch twice
+
+//file layout (little endian):
+//  header 24 bytes: "SDKL", version, sequence number before the first frame, 0,
+//                   cursor before the first frame (u64)
+//  frames: "SDKB", seq, count, cursor (u64), crc32 of the rest of the frame header + records,
+//          then count * SUDOKU_STORE_RECORD_SIZE bytes
+//frame numbers go up by one; reading stops at the first frame that does not check out
+
+#ifndef SUDOKU_LOG_H
+#define SUDOKU_LOG_H
+
+#include "sudoku_store.h"
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct SudokuLog {
+    FILE* file;
+    char* path;
+    int batch_size;
+    uint32_t base_seq;          // frames up to this one were compacted away
+    uint64_t base_cursor;       // cursor of frame base_seq
+    uint32_t seq;               // last committed frame (== base_seq if none)
+    uint64_t cursor;            // cursor of the last committed frame
+    long committed;             // entries in committed frames
+    long end;                   // file offset after the last committed frame
+
+    SudokuStoreEntry* pending;  // current batch, not on disk yet
+    int pending_count;
+    uint64_t pending_cursor;
+} SudokuLog;
+
+//opens (or creates) a log; batch_size entries make one frame
+//recovers from a torn last frame, see cursor / committed for what survived
+//store_path: the store it will be compacted into (null = none yet); a new log numbers its frames
+//on from the last one that store contains
+SudokuResult sudoku_log_open(SudokuLog* log, const char* path, const char* store_path, int batch_size);
+
+//adds an entry to the current batch and commits the batch when it is full
+//cursor is for the caller (eg. input line number after this entry); the last one of a batch is kept
+SudokuResult sudoku_log_append(SudokuLog* log, const SudokuStoreEntry* entry, uint64_t cursor);
+
+//writes the current batch as one frame and flushes it to disk (no-op if empty)
+SudokuResult sudoku_log_commit(SudokuLog* log);
+
+//commits the current batch and closes the file
+SudokuResult sudoku_log_close(SudokuLog* log);
+
+//store_path gets everything it had plus all committed entries of the log (served flags kept),
+//then the log starts empty (the cursor stays)
+//SUDOKU_ERR_INVALID_ARG if the log is behind the store (it was not opened for that store)
+SudokuResult sudoku_log_compact(SudokuLog* log, const char* store_path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
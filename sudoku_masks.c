@@ -0,0 +1,182 @@
+// sudoku_masks.c - clue mask library
+
+#include "sudoku_masks.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+void sudoku_mask_library_init(SudokuMaskLibrary* lib) {
+    if (!lib) return;
+    memset(lib, 0, sizeof(*lib));
+}
+
+void sudoku_mask_library_free(SudokuMaskLibrary* lib) {
+    if (!lib) return;
+    free(lib->masks);
+    free(lib->grades);
+    memset(lib, 0, sizeof(*lib));
+}
+
+SudokuResult sudoku_mask_library_add(SudokuMaskLibrary* lib, const SudokuMask* mask, SudokuDifficulty grade) {
+    if (!lib || !mask) return SUDOKU_ERR_INVALID_ARG;
+    if (lib->count == lib->cap) {
+        int ncap = lib->cap ? lib->cap * 2 : 16;
+        SudokuMask* nm = (SudokuMask*)realloc(lib->masks, (size_t)ncap * sizeof(SudokuMask));
+        if (!nm) return SUDOKU_ERR_NO_MEMORY;
+        lib->masks = nm;
+        SudokuDifficulty* ng = (SudokuDifficulty*)realloc(lib->grades, (size_t)ncap * sizeof(SudokuDifficulty));
+        if (!ng) return SUDOKU_ERR_NO_MEMORY;
+        lib->grades = ng;
+        lib->cap = ncap;
+    }
+    lib->masks[lib->count] = *mask;
+    lib->grades[lib->count] = grade;
+    ++lib->count;
+    return SUDOKU_OK;
+}
+
+static int parse_grade(const char* word, SudokuDifficulty* out) {
+    if (strcmp(word, "easy") == 0) *out = SUDOKU_DIFFICULTY_EASY;
+    else if (strcmp(word, "medium") == 0) *out = SUDOKU_DIFFICULTY_MEDIUM;
+    else if (strcmp(word, "hard") == 0) *out = SUDOKU_DIFFICULTY_HARD;
+    else return 0;
+    return 1;
+}
+
+static const char* grade_word(SudokuDifficulty grade) {
+    switch (grade) {
+        case SUDOKU_DIFFICULTY_EASY: return "easy";
+        case SUDOKU_DIFFICULTY_HARD: return "hard";
+        default: return "medium";
+    }
+}
+
+static int parse_mask(const char* s, SudokuMask* out) {
+    int n = 0;
+    for (const char* p = s; *p && n < 81; ++p) {
+        int keep;
+        if ((*p >= '1' && *p <= '9') || *p == 'x') keep = 1;
+        else if (*p == '0' || *p == '.') keep = 0;
+        else break;
+        out->keep[n / 9][n % 9] = (unsigned char)keep;
+        ++n;
+    }
+    return n == 81;
+}
+
+SudokuResult sudoku_mask_library_load(SudokuMaskLibrary* lib, const char* path) {
+    if (!lib || !path) return SUDOKU_ERR_INVALID_ARG;
+    FILE* f = fopen(path, "r");
+    if (!f) return SUDOKU_ERR_IO;
+
+    char line[256];
+    SudokuResult res = SUDOKU_OK;
+    while (res == SUDOKU_OK && fgets(line, sizeof(line), f)) {
+        if (line[0] == '#') continue;
+        char word[16];
+        char pattern[128];
+        if (sscanf(line, "%15s %127s", word, pattern) != 2) continue;
+
+        SudokuDifficulty grade;
+        SudokuMask mask;
+        if (!parse_grade(word, &grade) || !parse_mask(pattern, &mask)) continue;
+        res = sudoku_mask_library_add(lib, &mask, grade);
+    }
+    fclose(f);
+    return res;
+}
+
+SudokuResult sudoku_mask_library_save(const SudokuMaskLibrary* lib, const char* path) {
+    if (!lib || !path) return SUDOKU_ERR_INVALID_ARG;
+    FILE* f = fopen(path, "w");
+    if (!f) return SUDOKU_ERR_IO;
+    for (int i = 0; i < lib->count; ++i) {
+        fputs(grade_word(lib->grades[i]), f);
+        fputc(' ', f);
+        for (int k = 0; k < 81; ++k) fputc(lib->masks[i].keep[k / 9][k % 9] ? 'x' : '.', f);
+        fputc('\n', f);
+    }
+    if (fclose(f) != 0) return SUDOKU_ERR_IO;
+    return SUDOKU_OK;
+}
+
+const SudokuMask* sudoku_mask_library_pick(const SudokuMaskLibrary* lib, SudokuDifficulty grade) {
+    if (!lib) return NULL;
+    int n = 0;
+    for (int i = 0; i < lib->count; ++i) {
+        if (lib->grades[i] == grade) ++n;
+    }
+    if (n == 0) return NULL;
+
+    int want = rand() % n;
+    for (int i = 0; i < lib->count; ++i) {
+        if (lib->grades[i] != grade) continue;
+        if (want-- == 0) return &lib->masks[i];
+    }
+    return NULL;
+}
+
+void sudoku_mask_from_puzzle(const SudokuBoard* puzzle, SudokuMask* out_mask) {
+    if (!puzzle || !out_mask) return;
+    for (int r = 0; r < 9; ++r) {
+        for (int c = 0; c < 9; ++c) {
+            out_mask->keep[r][c] = (unsigned char)(puzzle->cell[r][c] != 0);
+        }
+    }
+}
+
+//fallback: remove clues in random order, only if the puzzle stays unique
+static void dig_unique(SudokuBoard* puzzle, int target_holes) {
+    int order[81];
+    for (int i = 0; i < 81; ++i) order[i] = i;
+    for (int i = 80; i > 0; --i) {
+        int j = rand() % (i + 1);
+        int tmp = order[i];
+        order[i] = order[j];
+        order[j] = tmp;
+    }
+
+    int holes = 0;
+    for (int i = 0; i < 81 && holes < target_holes; ++i) {
+        int r = order[i] / 9, c = order[i] % 9;
+        int saved = puzzle->cell[r][c];
+        puzzle->cell[r][c] = 0;
+        if (sudoku_count_solutions(puzzle, 2, NULL) == 1) {
+            ++holes;
+        } else {
+            puzzle->cell[r][c] = saved;
+        }
+    }
+}
+
+SudokuResult sudoku_generate_puzzle_from_mask(
+    const SudokuMask* mask,
+    SudokuBoard* out_puzzle,
+    SudokuBoard* out_solution,
+    int* out_used_mask
+) {
+    if (!mask || !out_puzzle || !out_solution) return SUDOKU_ERR_INVALID_ARG;
+    if (out_used_mask) *out_used_mask = 0;
+
+    SudokuResult r = sudoku_generate_solution(out_solution);
+    if (r != SUDOKU_OK) return r;
+
+    int holes = 0;
+    for (int row = 0; row < 9; ++row) {
+        for (int col = 0; col < 9; ++col) {
+            int keep = mask->keep[row][col];
+            out_puzzle->cell[row][col] = keep ? out_solution->cell[row][col] : 0;
+            if (!keep) ++holes;
+        }
+    }
+
+    //the fast path: one solution count
+    if (sudoku_count_solutions(out_puzzle, 2, NULL) == 1) {
+        if (out_used_mask) *out_used_mask = 1;
+        return SUDOKU_OK;
+    }
+
+    sudoku_copy(out_puzzle, out_solution);
+    dig_unique(out_puzzle, holes);
+    return SUDOKU_OK;
+}
@@ -0,0 +1,62 @@
+// sudoku_masks.h - clue mask library (known-good hole patterns)
+
+//a mask says which cells keep their clue; filling a good mask with a fresh random
+//solution usually gives a unique puzzle straight away, so generation needs one
+//solution count instead of a uniqueness check after every removed number
+
+//library file: one mask per line, "<easy|medium|hard> <81 chars>"
+//'1'..'9' or 'x' = clue, '0' or '.' = hole, so a puzzle line works as a mask too
+//lines starting with '#' are comments
+
+#ifndef SUDOKU_MASKS_H
+#define SUDOKU_MASKS_H
+
+#include "sudoku_module.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct SudokuMask {
+    // 1 = clue stays, 0 = hole
+    unsigned char keep[SUDOKU_SIZE][SUDOKU_SIZE];
+} SudokuMask;
+
+typedef struct SudokuMaskLibrary {
+    SudokuMask* masks;
+    SudokuDifficulty* grades;
+    int count;
+    int cap;
+} SudokuMaskLibrary;
+
+void sudoku_mask_library_init(SudokuMaskLibrary* lib);
+void sudoku_mask_library_free(SudokuMaskLibrary* lib);
+
+SudokuResult sudoku_mask_library_add(SudokuMaskLibrary* lib, const SudokuMask* mask, SudokuDifficulty grade);
+
+//appends all masks from a library file (see format above)
+SudokuResult sudoku_mask_library_load(SudokuMaskLibrary* lib, const char* path);
+SudokuResult sudoku_mask_library_save(const SudokuMaskLibrary* lib, const char* path);
+
+//random mask of the given grade, or null if the library has none
+const SudokuMask* sudoku_mask_library_pick(const SudokuMaskLibrary* lib, SudokuDifficulty grade);
+
+//mask of a puzzle's clues (eg. to add a mined puzzle to the library)
+void sudoku_mask_from_puzzle(const SudokuBoard* puzzle, SudokuMask* out_mask);
+
+//fills the mask with a new random solution and checks uniqueness once
+//if that puzzle is not unique, it digs a unique puzzle with the same number of holes instead
+//(one uniqueness check per removed number, like the slow path always did)
+//out_used_mask (optional) is set to 1 if the mask was accepted
+SudokuResult sudoku_generate_puzzle_from_mask(
+    const SudokuMask* mask,
+    SudokuBoard* out_puzzle,
+    SudokuBoard* out_solution,
+    int* out_used_mask
+);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,297 @@
+// sudoku_miner.c - local search miner for very hard puzzles
+
+// goal: find puzzles with a high grader score much faster than generating random
+//puzzles and throwing away the easy ones
+//every worker thread starts from a hard puzzle and keeps mutating it:
+//move a clue, swap a clue's digit, add a clue (and drop two others)
+//a mutation is kept if the puzzle is still unique and the score did not go down
+//(hill climbing, sideways moves allowed so it can walk over flat areas)
+//puzzles at or above --min-score are appended to the result store (--out)
+//with --seen, puzzles that are the same (up to symmetry) as anything in the seen set
+//are not stored, and stored ones are added to it
+
+// Build:
+//   gcc -std=c99 -O2 -Wall -Wextra -pedantic -pthread sudoku_module.c sudoku_cdcl.c sudoku_grade.c sudoku_dedupe.c sudoku_miner.c -o sudoku_miner
+
+// Run:
+//   ./sudoku_miner --in hard.txt --out mined.txt --threads 4 --iters 20000 --min-score 300 --seen seen.sdh
+
+//input: one puzzle per line, 81 chars, '0' or '.' = empty (anything after is ignored)
+//without --in, the seeds are generated with sudoku_generate_puzzle(HARD)
+//result store: one line per puzzle "<81 chars> <score> <hardest technique>"
+
+#include "sudoku_module.h"
+#include "sudoku_grade.h"
+#include "sudoku_dedupe.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MAX_SEEDS 4096
+#define MAX_THREADS 64
+
+//give up on a walk after this many iterations without a better score
+#define STALL_LIMIT 3000
+
+//skip full grading when the estimate is this far below the current score
+//(the estimate is off by ~90 on average for mined puzzles, so keep a wide margin)
+#define ESTIMATE_MARGIN 180
+
+typedef struct MinerShared {
+    SudokuBoard seeds[MAX_SEEDS];
+    int seed_count;
+    int min_score;
+    long iters;
+
+    FILE* out;
+    SudokuSeenSet* seen;     // optional, guarded by out_lock too
+    pthread_mutex_t out_lock;
+    long stored;
+    long duplicates;
+} MinerShared;
+
+typedef struct MinerWorker {
+    MinerShared* shared;
+    int id;
+    int threads;
+    unsigned int rng;
+    int best_score;
+} MinerWorker;
+
+//each worker has its own xorshift rng; rand() is shared global state
+static unsigned int next_rand(unsigned int* state) {
+    unsigned int x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+static int rand_below(unsigned int* state, int n) {
+    return (int)(next_rand(state) % (unsigned int)n);
+}
+
+static int load_seeds(MinerShared* sh, const char* path) {
+    FILE* f = fopen(path, "r");
+    if (!f) return 0;
+    char line[256];
+    while (sh->seed_count < MAX_SEEDS && fgets(line, sizeof(line), f)) {
+        SudokuBoard b;
+        if (!sudoku_board_from_string(line, &b)) continue;
+        if (sudoku_count_solutions(&b, 2, NULL) != 1) continue; // only unique seeds
+        sh->seeds[sh->seed_count++] = b;
+    }
+    fclose(f);
+    return sh->seed_count > 0;
+}
+
+//generated puzzles are not unique, so add clues from the solution until they are
+static void make_unique(SudokuBoard* puzzle, const SudokuBoard* solution) {
+    while (sudoku_count_solutions(puzzle, 2, NULL) > 1) {
+        int i = rand() % 81;
+        puzzle->cell[i / 9][i % 9] = solution->cell[i / 9][i % 9];
+    }
+}
+
+static int pick_cell(const SudokuBoard* b, unsigned int* rng, int want_clue) {
+    int cells[81];
+    int n = 0;
+    for (int i = 0; i < 81; ++i) {
+        if ((b->cell[i / 9][i % 9] != 0) == want_clue) cells[n++] = i;
+    }
+    if (n == 0) return -1;
+    return cells[rand_below(rng, n)];
+}
+
+//one random mutation of `cur`; the result may have 0 or many solutions, caller checks
+static int mutate(const SudokuBoard* cur, const SudokuBoard* sol, unsigned int* rng, SudokuBoard* out) {
+    *out = *cur;
+    int kind = rand_below(rng, 3);
+
+    if (kind == 0) {
+        //move: one clue goes to an empty cell (value from the current solution)
+        int from = pick_cell(out, rng, 1);
+        int to = pick_cell(out, rng, 0);
+        if (from < 0 || to < 0) return 0;
+        out->cell[from / 9][from % 9] = 0;
+        out->cell[to / 9][to % 9] = sol->cell[to / 9][to % 9];
+        return 1;
+    }
+
+    if (kind == 1) {
+        //swap: give a clue a different digit (the solution changes with it)
+        int at = pick_cell(out, rng, 1);
+        if (at < 0) return 0;
+        int r = at / 9, c = at % 9;
+        int old = out->cell[r][c];
+        out->cell[r][c] = 0;
+        int v = 1 + rand_below(rng, 9);
+        if (v == old || !sudoku_can_place(out, r, c, v)) return 0;
+        out->cell[r][c] = v;
+        return 1;
+    }
+
+    //add: one new clue from the solution, then drop two others
+    int to = pick_cell(out, rng, 0);
+    if (to < 0) return 0;
+    out->cell[to / 9][to % 9] = sol->cell[to / 9][to % 9];
+    for (int k = 0; k < 2; ++k) {
+        int from = pick_cell(out, rng, 1);
+        if (from < 0 || from == to) return 0;
+        out->cell[from / 9][from % 9] = 0;
+    }
+    return 1;
+}
+
+static void store_result(MinerShared* sh, const SudokuBoard* b, const SudokuGrade* g) {
+    char s[82];
+    sudoku_board_to_string(b, s);
+    uint64_t hash = sh->seen ? sudoku_canonical_hash(b) : 0;
+    pthread_mutex_lock(&sh->out_lock);
+    if (sh->seen) {
+        //the add is the exact check: another program on the same file may have added it
+        int added = 0;
+        if (sudoku_seen_contains(sh->seen, hash) ||
+            (sudoku_seen_add(sh->seen, hash, &added) == SUDOKU_OK && !added)) {
+            ++sh->duplicates;
+            pthread_mutex_unlock(&sh->out_lock);
+            return;
+        }
+    }
+    fprintf(sh->out, "%s %d %s\n", s, g->score, sudoku_technique_name((SudokuTechnique)g->hardest));
+    fflush(sh->out);
+    ++sh->stored;
+    pthread_mutex_unlock(&sh->out_lock);
+}
+
+static void* miner_thread(void* arg) {
+    MinerWorker* w = (MinerWorker*)arg;
+    MinerShared* sh = w->shared;
+    int next_seed = w->id;
+
+    SudokuBoard cur, sol;
+    SudokuGrade cur_grade;
+    int walk_best = -1;
+    long stall = STALL_LIMIT;
+
+    for (long it = 0; it < sh->iters; ++it) {
+        if (stall >= STALL_LIMIT) {
+            //(re)start a walk from the next seed of this worker
+            cur = sh->seeds[next_seed % sh->seed_count];
+            next_seed += w->threads;
+            sudoku_count_solutions(&cur, 1, &sol);
+            sudoku_grade(&cur, &cur_grade);
+            walk_best = cur_grade.score;
+            stall = 0;
+        }
+
+        SudokuBoard cand, cand_sol;
+        SudokuGrade g;
+        ++stall;
+        if (!mutate(&cur, &sol, &w->rng, &cand)) continue;
+        SudokuSolveStats st;
+        if (sudoku_count_solutions_stats(&cand, 2, &cand_sol, &st) != 1) continue;
+        //cheap estimate from the uniqueness check first, full grading only if it might be close
+        if (sudoku_estimate_score(&st) + ESTIMATE_MARGIN < cur_grade.score) continue;
+        if (sudoku_grade(&cand, &g) != SUDOKU_OK) continue;
+        if (g.score < cur_grade.score) continue;
+
+        cur = cand;
+        sol = cand_sol;
+        cur_grade = g;
+        if (g.score > walk_best) {
+            walk_best = g.score;
+            stall = 0;
+            if (g.score >= sh->min_score) store_result(sh, &cur, &g);
+        }
+        if (g.score > w->best_score) w->best_score = g.score;
+    }
+    return NULL;
+}
+
+int main(int argc, char** argv) {
+    const char* in_path = NULL;
+    const char* out_path = "mined.txt";
+    const char* seen_path = NULL;
+    int threads = 4;
+
+    static MinerShared sh;
+    sh.iters = 20000;
+    sh.min_score = 300;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--in") == 0 && i + 1 < argc) in_path = argv[++i];
+        else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) out_path = argv[++i];
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--iters") == 0 && i + 1 < argc) sh.iters = atol(argv[++i]);
+        else if (strcmp(argv[i], "--min-score") == 0 && i + 1 < argc) sh.min_score = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--seen") == 0 && i + 1 < argc) seen_path = argv[++i];
+        else {
+            fprintf(stderr, "usage: %s [--in seeds.txt] [--out mined.txt] [--threads N] [--iters N] [--min-score S] [--seen seen.sdh]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (threads < 1) threads = 1;
+    if (threads > MAX_THREADS) threads = MAX_THREADS;
+
+    sudoku_seed((unsigned int)time(NULL));
+
+    if (in_path) {
+        if (!load_seeds(&sh, in_path)) {
+            fprintf(stderr, "No unique puzzles found in %s\n", in_path);
+            return 1;
+        }
+    } else {
+        for (int i = 0; i < threads; ++i) {
+            SudokuBoard p, s;
+            if (sudoku_generate_puzzle(&p, &s, SUDOKU_DIFFICULTY_HARD) != SUDOKU_OK) return 1;
+            make_unique(&p, &s);
+            sh.seeds[sh.seed_count++] = p;
+        }
+    }
+
+    sh.out = fopen(out_path, "a");
+    if (!sh.out) {
+        fprintf(stderr, "Failed to open %s\n", out_path);
+        return 1;
+    }
+    static SudokuSeenSet seen;
+    if (seen_path) {
+        if (sudoku_seen_open(&seen, seen_path) != SUDOKU_OK) {
+            fprintf(stderr, "Failed to open seen set %s\n", seen_path);
+            return 1;
+        }
+        sh.seen = &seen;
+    }
+    pthread_mutex_init(&sh.out_lock, NULL);
+
+    pthread_t tids[MAX_THREADS];
+    MinerWorker workers[MAX_THREADS];
+    for (int i = 0; i < threads; ++i) {
+        workers[i].shared = &sh;
+        workers[i].id = i;
+        workers[i].threads = threads;
+        workers[i].rng = (unsigned int)rand() | 1u;
+        workers[i].best_score = 0;
+        if (pthread_create(&tids[i], NULL, miner_thread, &workers[i]) != 0) {
+            threads = i;
+            break;
+        }
+    }
+
+    int best = 0;
+    for (int i = 0; i < threads; ++i) {
+        pthread_join(tids[i], NULL);
+        if (workers[i].best_score > best) best = workers[i].best_score;
+    }
+
+    pthread_mutex_destroy(&sh.out_lock);
+    fclose(sh.out);
+    if (sh.seen) sudoku_seen_close(sh.seen);
+    printf("OK: %ld puzzles stored in %s (best score %d, %ld already seen)\n", sh.stored, out_path, best, sh.duplicates);
+    return 0;
+}
@@ -1,11 +1,29 @@
 // sudoku_module.c - implementation
 
+//getpid / fsync / fileno are posix, not c99
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200112L
+#endif
+
 #include "sudoku_module.h"
+#include "sudoku_cdcl.h"
 
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#include <process.h>
+#define process_id() _getpid()
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#define process_id() getpid()
+#endif
+
 // rng (simple wrapper around rand)
 
 static int g_seeded = 0;
@@ -131,31 +149,262 @@ static int solve_backtrack(SudokuBoard* b) {
     return 0;
 }
 
+static SudokuEngine g_engine = SUDOKU_ENGINE_BACKTRACK;
+
+void sudoku_set_engine(SudokuEngine engine) {
+    g_engine = engine;
+}
+
+SudokuEngine sudoku_get_engine(void) {
+    return g_engine;
+}
+
+static SudokuResult solve_with_engine(SudokuBoard* b) {
+    if (g_engine == SUDOKU_ENGINE_CDCL) return sudoku_cdcl_solve(b);
+    if (solve_backtrack(b)) return SUDOKU_OK;
+    return SUDOKU_ERR_UNSOLVABLE;
+}
+
 SudokuResult sudoku_solve(SudokuBoard* in_out_board) {
     if (!in_out_board) return SUDOKU_ERR_INVALID_ARG;
     seed_if_needed();
     if (!sudoku_is_valid_partial(in_out_board)) return SUDOKU_ERR_UNSOLVABLE;
-    if (solve_backtrack(in_out_board)) return SUDOKU_OK;
-    return SUDOKU_ERR_UNSOLVABLE;
+    return solve_with_engine(in_out_board);
+}
+
+//bitmask solver (used for probing, not for generation)
+//every row/col/box keeps a 9 bit mask of used values: bit (v-1) set = v is used
+//ban[] holds extra per cell forbidden values, so a probe can say "this cell is not v"
+//the state is a plain struct, so copying it is the "incremental" part: we set up
+//the board once and then copy + tweak it for every probe instead of rebuilding
+typedef struct MaskSolver {
+    int cell[81];
+    unsigned short row[9];
+    unsigned short col[9];
+    unsigned short box[9];
+    unsigned short ban[81];
+} MaskSolver;
+
+#define MASK_ALL 0x1FFu
+
+static int box_of(int r, int c) {
+    return (r / 3) * 3 + c / 3;
+}
+
+static int bit_count9(unsigned int m) {
+    int n = 0;
+    while (m) {
+        m &= m - 1;
+        ++n;
+    }
+    return n;
+}
+
+static void mask_place(MaskSolver* s, int idx, int v) {
+    unsigned short bit = (unsigned short)(1u << (v - 1));
+    int r = idx / 9, c = idx % 9;
+    s->cell[idx] = v;
+    s->row[r] |= bit;
+    s->col[c] |= bit;
+    s->box[box_of(r, c)] |= bit;
+}
+
+static void mask_unplace(MaskSolver* s, int idx, int v) {
+    unsigned short bit = (unsigned short)(1u << (v - 1));
+    int r = idx / 9, c = idx % 9;
+    s->cell[idx] = 0;
+    s->row[r] &= (unsigned short)~bit;
+    s->col[c] &= (unsigned short)~bit;
+    s->box[box_of(r, c)] &= (unsigned short)~bit;
+}
+
+static unsigned int mask_candidates(const MaskSolver* s, int idx) {
+    int r = idx / 9, c = idx % 9;
+    unsigned int used = s->row[r] | s->col[c] | s->box[box_of(r, c)] | s->ban[idx];
+    return ~used & MASK_ALL;
+}
+
+//returns 0 if the board breaks the rules
+static int mask_solver_init(MaskSolver* s, const SudokuBoard* b) {
+    memset(s, 0, sizeof(*s));
+    for (int i = 0; i < 81; ++i) {
+        int v = b->cell[i / 9][i % 9];
+        if (v == 0) continue;
+        if (!is_in_range_1_9(v)) return 0;
+        if (!(mask_candidates(s, i) & (1u << (v - 1)))) return 0;
+        mask_place(s, i, v);
+    }
+    return 1;
+}
+
+//counts solutions up to `limit`; the first one found is copied into first_out (if not null)
+//picks the empty cell with the fewest candidates each time (so forced cells go first)
+//st (optional) collects search statistics, depth = how many guesses led here
+static void mask_search(MaskSolver* s, int limit, int* count, int* first_out, SudokuSolveStats* st, int depth) {
+    int best = -1;
+    int best_n = 10;
+    unsigned int best_mask = 0;
+    for (int i = 0; i < 81; ++i) {
+        if (s->cell[i] != 0) continue;
+        unsigned int m = mask_candidates(s, i);
+        int n = bit_count9(m);
+        if (n < best_n) {
+            best = i;
+            best_n = n;
+            best_mask = m;
+            if (n <= 1) break;
+        }
+    }
+
+    if (st) {
+        ++st->nodes;
+        if (best_n > 1 && best >= 0) {
+            ++st->branches;
+            if (depth + 1 > st->max_depth) st->max_depth = depth + 1;
+        }
+    }
+
+    if (best < 0) {
+        //no empty cell left = solution
+        if (*count == 0 && first_out) memcpy(first_out, s->cell, sizeof(s->cell));
+        ++*count;
+        return;
+    }
+
+    int next_depth = (best_n > 1) ? depth + 1 : depth;
+    for (int v = 1; v <= 9 && *count < limit; ++v) {
+        if (!(best_mask & (1u << (v - 1)))) continue;
+        mask_place(s, best, v);
+        mask_search(s, limit, count, first_out, st, next_depth);
+        mask_unplace(s, best, v);
+    }
+}
+
+int sudoku_count_solutions(const SudokuBoard* board, int limit, SudokuBoard* out_solution) {
+    return sudoku_count_solutions_stats(board, limit, out_solution, NULL);
+}
+
+int sudoku_count_solutions_stats(
+    const SudokuBoard* board,
+    int limit,
+    SudokuBoard* out_solution,
+    SudokuSolveStats* out_stats
+) {
+    if (!board || limit <= 0) return -1;
+    if (out_stats) memset(out_stats, 0, sizeof(*out_stats));
+
+    MaskSolver s;
+    if (!mask_solver_init(&s, board)) return 0;
+
+    if (out_stats) {
+        for (int i = 0; i < 81; ++i) {
+            if (s.cell[i] != 0) continue;
+            ++out_stats->empty_cells;
+            if (bit_count9(mask_candidates(&s, i)) == 1) ++out_stats->start_singles;
+        }
+    }
+
+    int first[81];
+    int count = 0;
+    mask_search(&s, limit, &count, first, out_stats, 0);
+    if (count > 0 && out_solution) {
+        for (int i = 0; i < 81; ++i) out_solution->cell[i / 9][i % 9] = first[i];
+    }
+    return count;
+}
+
+SudokuResult sudoku_backbone(const SudokuBoard* board, SudokuBoard* out_forced) {
+    if (!board || !out_forced) return SUDOKU_ERR_INVALID_ARG;
+
+    MaskSolver base;
+    if (!mask_solver_init(&base, board)) return SUDOKU_ERR_UNSOLVABLE;
+
+    //1) any one solution: the backbone can only contain its values
+    int first[81];
+    int count = 0;
+    MaskSolver work = base;
+    mask_search(&work, 1, &count, first, NULL, 0);
+    if (count == 0) return SUDOKU_ERR_UNSOLVABLE;
+
+    //2) probe every still-possible cell with "cell != first value"
+    //if that has a solution, every cell where it differs from `first` is not forced either,
+    //so one probe often knocks out many cells at once (sat style backbone detection)
+    //if it has no solution, the cell is forced and we put it into the base state,
+    //which makes the following probes smaller
+    int maybe[81];
+    for (int i = 0; i < 81; ++i) maybe[i] = (base.cell[i] == 0);
+
+    for (int i = 0; i < 81; ++i) {
+        if (!maybe[i]) continue;
+
+        int other[81];
+        count = 0;
+        work = base;
+        work.ban[i] |= (unsigned short)(1u << (first[i] - 1));
+        mask_search(&work, 1, &count, other, NULL, 0);
+
+        if (count == 0) {
+            mask_place(&base, i, first[i]);
+            continue;
+        }
+        for (int j = i; j < 81; ++j) {
+            if (maybe[j] && other[j] != first[j]) maybe[j] = 0;
+        }
+    }
+
+    //givens + probed cells are exactly what ended up in the base state
+    for (int i = 0; i < 81; ++i) {
+        out_forced->cell[i / 9][i % 9] = base.cell[i];
+    }
+    return SUDOKU_OK;
 }
 
 SudokuResult sudoku_generate_solution(SudokuBoard* out_solution) {
     if (!out_solution) return SUDOKU_ERR_INVALID_ARG;
     seed_if_needed();
     sudoku_clear(out_solution);
-    if (solve_backtrack(out_solution)) return SUDOKU_OK;
-    return SUDOKU_ERR_UNSOLVABLE;
+    return solve_with_engine(out_solution);
 }
 
-//count holes (0)
-static int count_holes(const SudokuBoard* b) {
-    int holes = 0;
+int sudoku_count_clues(const SudokuBoard* board) {
+    if (!board) return 0;
+    int n = 0;
     for (int r = 0; r < 9; ++r) {
         for (int c = 0; c < 9; ++c) {
-            if (b->cell[r][c] == 0) ++holes;
+            if (board->cell[r][c] != 0) ++n;
+        }
+    }
+    return n;
+}
+
+//count holes (0)
+static int count_holes(const SudokuBoard* b) {
+    return 81 - sudoku_count_clues(b);
+}
+
+int sudoku_board_from_string(const char* line, SudokuBoard* out_board) {
+    if (!line || !out_board) return 0;
+    int n = 0;
+    for (const char* p = line; *p && n < 81; ++p) {
+        if (*p >= '1' && *p <= '9') {
+            out_board->cell[n / 9][n % 9] = *p - '0';
+        } else if (*p == '0' || *p == '.') {
+            out_board->cell[n / 9][n % 9] = 0;
+        } else {
+            break;
         }
+        ++n;
+    }
+    return n == 81;
+}
+
+void sudoku_board_to_string(const SudokuBoard* board, char* out82) {
+    if (!board || !out82) return;
+    for (int i = 0; i < 81; ++i) {
+        int v = board->cell[i / 9][i % 9];
+        out82[i] = (v >= 1 && v <= 9) ? (char)('0' + v) : '.';
     }
-    return holes;
+    out82[81] = '\0';
 }
 
 int sudoku_holes_for_difficulty(SudokuDifficulty difficulty) {
@@ -170,15 +419,6 @@ int sudoku_holes_for_difficulty(SudokuDifficulty difficulty) {
     }
 }
 
-static const char* difficulty_label(SudokuDifficulty difficulty) {
-    switch (difficulty) {
-        case SUDOKU_DIFFICULTY_EASY: return "Easy";
-        case SUDOKU_DIFFICULTY_MEDIUM: return "Medium";
-        case SUDOKU_DIFFICULTY_HARD: return "Hard";
-        default: return "Medium";
-    }
-}
-
 SudokuResult sudoku_generate_puzzle(
     SudokuBoard* out_puzzle,
     SudokuBoard* out_solution,
@@ -220,222 +460,48 @@ SudokuResult sudoku_generate_puzzle(
     return SUDOKU_OK;
 }
 
-//html export
-
-
-static void fprint_html_escaped(FILE* f, const char* s) {
-    //very small escaper for titles
-    for (const char* p = s ? s : ""; *p; ++p) {
-        switch (*p) {
-            case '&': fputs("&amp;", f); break;
-            case '<': fputs("&lt;", f); break;
-            case '>': fputs("&gt;", f); break;
-            case '"': fputs("&quot;", f); break;
-            case '\'': fputs("&#39;", f); break;
-            default: fputc(*p, f); break;
-        }
-    }
-}
-
-static int is_css_safe_char(char ch) {
-    //allow only a conservative subset for inline CSS values
-    //if you pass "#dabfae" or "rgb(1,2,3)" it will work
-    if ((ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z')) return 1;
-    if (ch >= '0' && ch <= '9') return 1;
-    switch (ch) {
-        case '#':
-        case '(':
-        case ')':
-        case ',':
-        case '.':
-        case '%':
-        case ' ':
-        case '-':
-        case '_':
-            return 1;
-        default:
-            return 0;
-    }
-}
-
-static void fprint_css_value(FILE* f, const char* s) {
-    //print a css value, but drop unsafe characters to avoid breaking the page
-    for (const char* p = s ? s : ""; *p; ++p) {
-        if (is_css_safe_char(*p)) fputc(*p, f);
-    }
-}
+//replacing files
 
-SudokuResult sudoku_write_html_page(
-    const char* html_path,
-    const char* css_href,
-    const SudokuBoard* puzzle,
-    const SudokuTheme* theme,
-    SudokuDifficulty difficulty
-) {
-    return sudoku_write_html_page_with_solution(
-        html_path, css_href, puzzle, NULL, theme, difficulty
-    );
+int sudoku_temp_path(const char* path, char* out, size_t out_size) {
+    if (!path || !out || out_size == 0) return 0;
+    int n = snprintf(out, out_size, "%s.%ld.tmp", path, (long)process_id());
+    return n > 0 && (size_t)n < out_size;
 }
 
-static int board_is_filled_1_9(const SudokuBoard* b) {
-    if (!b) return 0;
-    for (int r = 0; r < 9; ++r) {
-        for (int c = 0; c < 9; ++c) {
-            if (!is_in_range_1_9(b->cell[r][c])) return 0;
-        }
-    }
-    return 1;
+SudokuResult sudoku_replace_file(const char* tmp, const char* path) {
+    if (!tmp || !path) return SUDOKU_ERR_INVALID_ARG;
+#ifdef _WIN32
+    //rename() does not replace an existing file on windows
+    return MoveFileExA(tmp, path, MOVEFILE_REPLACE_EXISTING) ? SUDOKU_OK : SUDOKU_ERR_IO;
+#else
+    //on failure neither file is touched: path keeps the old content, tmp the new one
+    return rename(tmp, path) == 0 ? SUDOKU_OK : SUDOKU_ERR_IO;
+#endif
 }
 
-static void fprint_solution_attr(FILE* f, const SudokuBoard* solved) {
-    //prints row-major 81 digits (1..9), caller must ensure solved is valid
-    for (int r = 0; r < 9; ++r) {
-        for (int c = 0; c < 9; ++c) {
-            fputc('0' + solved->cell[r][c], f);
-        }
-    }
+SudokuResult sudoku_sync_file(FILE* f) {
+    if (!f || fflush(f) != 0) return SUDOKU_ERR_IO;
+#ifdef _WIN32
+    return _commit(_fileno(f)) == 0 ? SUDOKU_OK : SUDOKU_ERR_IO;
+#else
+    return fsync(fileno(f)) == 0 ? SUDOKU_OK : SUDOKU_ERR_IO;
+#endif
 }
 
-SudokuResult sudoku_write_html_page_with_solution(
-    const char* html_path,
-    const char* css_href,
-    const SudokuBoard* puzzle,
-    const SudokuBoard* out_solution,
-    const SudokuTheme* theme,
-    SudokuDifficulty difficulty
-) {
-    if (!html_path || !css_href || !puzzle) return SUDOKU_ERR_INVALID_ARG;
-
-    FILE* f = fopen(html_path, "w");
-    if (!f) return SUDOKU_ERR_IO;
-
-    const char* title = (theme && theme->page_title) ? theme->page_title : "Sudoku";
-
-    //header
-    fputs("<!DOCTYPE html>\n", f);
-    fputs("<html lang=\"en\">\n", f);
-    fputs("<head>\n", f);
-    fputs("    <meta charset=\"utf-8\">\n", f);
-    fputs("    <meta name=\"viewport\" content=\"width=device-width, initial-scale=1\">\n", f);
-    fputs("    <title>", f);
-    fprint_html_escaped(f, title);
-    fputs("</title>\n", f);
-    fputs("    <link rel=\"stylesheet\" href=\"", f);
-    fprint_html_escaped(f, css_href);
-    fputs("\">\n", f);
-    fputs("    <script src=\"sudoku.js\" defer></script>\n", f);
-
-    if (theme && (theme->panel_bg || theme->cell_hover_bg)) {
-        fputs("    <style>\n", f);
-        if (theme->panel_bg) {
-            fputs("      header h1, main .game, main .difficulty, main .leaderboard { background-color: ", f);
-            fprint_css_value(f, theme->panel_bg);
-            fputs("; }\n", f);
-        }
-        if (theme->cell_hover_bg) {
-            fputs("      main .game .container .cell:hover { background-color: ", f);
-            fprint_css_value(f, theme->cell_hover_bg);
-            fputs("; }\n", f);
-        }
-        //make given cells stand out a bit
-        fputs("      .cell.given { display:flex; align-items:center; justify-content:center; font-weight:bold; font-size: 1.2em; }\n", f);
-        fputs("      .cell.empty { display:flex; align-items:center; justify-content:center; color:#666; }\n", f);
-        fputs("    </style>\n", f);
-    } else {
-        fputs("    <style>\n", f);
-        fputs("      .cell { display:flex; align-items:center; justify-content:center; font-weight:bold; font-size: 1.2em; }\n", f);
-        fputs("      .cell.empty { font-weight: normal; color:#666; }\n", f);
-        fputs("    </style>\n", f);
-    }
-
-    fputs("</head>\n", f);
-    fputs("<body>\n", f);
-    fputs("    <header>\n", f);
-    fputs("        <h1>", f);
-    fprint_html_escaped(f, title);
-    fputs("</h1>\n", f);
-    fputs("        <br><br>\n", f);
-    fputs("    </header>\n", f);
-
-    fputs("    <main>\n", f);
-    fputs("        <div class=\"game\">\n", f);
-    fputs("            <div class=\"score\">\n", f);
-    fputs("                <div class=\"time\">Time: 10:00</div>\n", f);
-    fputs("                <div class=\"points\">Score: 0</div>\n", f);
-    fputs("                <div class=\"mistakes\">Mistakes: 0/3</div>\n", f);
-    fputs("            </div>\n", f);
-    fputs("            <div class=\"container\"", f);
-    if (out_solution && board_is_filled_1_9(out_solution)) {
-        fputs(" data-solution=\"", f);
-        fprint_solution_attr(f, out_solution);
-        fputs("\"", f);
-    }
-    fputs(">\n", f);
-
-    //81 cells: row-major
-    for (int r = 0; r < 9; ++r) {
-        for (int c = 0; c < 9; ++c) {
-            int v = puzzle->cell[r][c];
-            if (v == 0) {
-                fputs("                <div class=\"cell empty\"></div>\n", f);
-            } else {
-                fputs("                <div class=\"cell given\">", f);
-                fputc('0' + v, f);
-                fputs("</div>\n", f);
-            }
-        }
-    }
-
-    fputs("            </div>\n", f);
-    fputs("        </div>\n", f);
-
-    //diff panel
-    fputs("        <div class=\"difficulty\">\n", f);
-    fputs("            <h2>Difficulty</h2>\n", f);
-    fputs("            <ul>\n", f);
-
-    const char* lbl = difficulty_label(difficulty);
-    fputs("                <li", f);
-    if (strcmp(lbl, "Easy") == 0) fputs(" class=\"active\"", f);
-    fputs("><a href=\"sudoku_easy.html\">Easy</a></li>\n", f);
-    fputs("                <li", f);
-    if (strcmp(lbl, "Medium") == 0) fputs(" class=\"active\"", f);
-    fputs("><a href=\"sudoku_medium.html\">Medium</a></li>\n", f);
-    fputs("                <li", f);
-    if (strcmp(lbl, "Hard") == 0) fputs(" class=\"active\"", f);
-    fputs("><a href=\"sudoku_hard.html\">Hard</a></li>\n", f);
-
-    fputs("            </ul>\n", f);
-    fputs("            <div class=\"buttons\">\n", f);
-    fputs("                <button class=\"b\" data-action=\"start\">Start</button>\n", f);
-    fputs("                <button class=\"b\" data-action=\"pause\">Pause</button>\n", f);
-    fputs("                <button class=\"b\" data-action=\"reset\">Reset</button>\n", f);
-    fputs("            </div>\n", f);
-    fputs("        </div>\n", f);
-
-    //leaderboard (currently left completely static, as implementing it would add a ton of complexity
-    fputs("        <div class=\"leaderboard\">\n", f);
-    fputs("            <h2>Leaderboard</h2>\n", f);
-    fputs("            <ol>\n", f);
-    fputs("                <li>Malunke</li>\n", f);
-    fputs("                <li>Andrius</li>\n", f);
-    fputs("                <li>Adomas</li>\n", f);
-    fputs("                <li>Irmantas</li>\n", f);
-    fputs("                <li>Arvydas</li>\n", f);
-    fputs("                <li>Luna</li>\n", f);
-    fputs("                <li>Gabija</li>\n", f);
-    fputs("                <li>Augustas</li>\n", f);
-    fputs("                <li>Kostas</li>\n", f);
-    fputs("                <li>Justas</li>\n", f);
-    fputs("            </ol>\n", f);
-    fputs("        </div>\n", f);
-
-    fputs("    </main>\n", f);
-    fputs("    <footer></footer>\n", f);
-    fputs("</body>\n", f);
-    fputs("</html>\n", f);
-
-    fclose(f);
+SudokuResult sudoku_sync_dir_of(const char* path) {
+    if (!path) return SUDOKU_ERR_INVALID_ARG;
+#ifdef _WIN32
     return SUDOKU_OK;
+#else
+    char dir[1024];
+    const char* slash = strrchr(path, '/');
+    if (!slash) snprintf(dir, sizeof(dir), ".");
+    else if (slash == path) snprintf(dir, sizeof(dir), "/");
+    else snprintf(dir, sizeof(dir), "%.*s", (int)(slash - path), path);
+    int fd = open(dir, O_RDONLY);
+    if (fd < 0) return SUDOKU_ERR_IO;
+    int ok = fsync(fd) == 0;
+    if (close(fd) != 0) ok = 0;
+    return ok ? SUDOKU_OK : SUDOKU_ERR_IO;
+#endif
 }
-
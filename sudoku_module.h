@@ -34,9 +34,28 @@ typedef enum SudokuResult {
     SUDOKU_OK = 0,
     SUDOKU_ERR_INVALID_ARG = 1,
     SUDOKU_ERR_UNSOLVABLE = 2,
-    SUDOKU_ERR_IO = 3
+    SUDOKU_ERR_IO = 3,
+    SUDOKU_ERR_NO_MEMORY = 4
 } SudokuResult;
 
+typedef enum SudokuEngine {
+    //simple backtracking (default, see README)
+    SUDOKU_ENGINE_BACKTRACK = 0,
+    //clause learning sat solver (sudoku_cdcl.c), does not thrash on very hard boards
+    SUDOKU_ENGINE_CDCL = 1
+} SudokuEngine;
+
+//what the solver saw while counting solutions (see sudoku_count_solutions_stats)
+typedef struct SudokuSolveStats {
+    //only what sudoku_estimate_score() uses (candidate totals and forced steps were tried too,
+    //they did not make the estimate any better)
+    long nodes;         // search steps
+    long branches;      // steps where the solver had to try several values
+    int max_depth;      // most guesses on one path
+    int empty_cells;    // at the start
+    int start_singles;  // empty cells with exactly one candidate at the start
+} SudokuSolveStats;
+
 typedef struct SudokuTheme {
     //simple theming (used only in generated css overrides inside the htmL)
     //strings should be valid css values, eg "#dabfae" or "rgb(153, 11, 58)"
@@ -62,6 +81,10 @@ int sudoku_is_valid_partial(const SudokuBoard* board);
 int sudoku_can_place(const SudokuBoard* board, int row, int col, int value);
 
 //solver/generator
+//selects the engine used by sudoku_solve() and sudoku_generate_solution()
+void sudoku_set_engine(SudokuEngine engine);
+SudokuEngine sudoku_get_engine(void);
+
 //solves a puzzle in-place (0 = empty); returns SUDOKU_OK if solved
 SudokuResult sudoku_solve(SudokuBoard* in_out_board);
 
@@ -76,8 +99,34 @@ SudokuResult sudoku_generate_puzzle(
     SudokuDifficulty difficulty
 );
 
+//counts solutions of `board`, stops as soon as `limit` are found (use 2 to check uniqueness)
+//out_solution (optional) gets the first solution found
+//returns 0..limit, or -1 for invalid args. does not use the rng or any global state,
+//so it is safe to call from several threads at once
+int sudoku_count_solutions(const SudokuBoard* board, int limit, SudokuBoard* out_solution);
+
+//same as sudoku_count_solutions(), but also fills out_stats (optional)
+//the numbers come from the same search, so they cost almost nothing extra;
+//sudoku_estimate_score() (sudoku_grade.h) turns them into a difficulty estimate
+int sudoku_count_solutions_stats(
+    const SudokuBoard* board,
+    int limit,
+    SudokuBoard* out_solution,
+    SudokuSolveStats* out_stats
+);
+
+//backbone analysis
+//fills out_forced with every cell whose value is the same in ALL solutions of `board`
+//(givens are included, other cells become 0). works on non-unique puzzles too
+//uses probing ("can this cell be something else?") instead of listing all solutions
+//returns SUDOKU_ERR_UNSOLVABLE if the board has no solution at all
+SudokuResult sudoku_backbone(const SudokuBoard* board, SudokuBoard* out_forced);
+
 //html exporter
 //writes an html page
+//the page writers below (and sudoku_write_theme_css) render through the template code, so they
+//live in sudoku_template.c: programs that write pages link that file too, the rest only need
+//sudoku_module.c
 
 // (header + main with .game and 81 .cell divs); filled cells get class "given"
 //poarams:
@@ -108,9 +157,69 @@ SudokuResult sudoku_write_html_page_with_solution(
     SudokuDifficulty difficulty
 );
 
+//extra page features for sudoku_write_html_page_ex(); zero-init / null = same page as above
+typedef struct SudokuPageOptions {
+    //base64 solve trace (sudoku_grade_trace + sudoku_trace_to_base64 in sudoku_grade.h)
+    //adds data-trace=" " and a "Show me" button that replays the solve in the browser
+    const char* trace;
+    //nonzero: no 81 cell divs, the grid goes into data-puzzle=" " (81 chars, 0 = empty) and
+    //sudoku.js builds the cells; a <noscript> text grid is left for browsers without js
+    int compact;
+    //href of a sudoku_write_theme_css() file; linked instead of the inline <style> block
+    const char* theme_css;
+    //path from the page to the site root (eg. "../../" for sharded pages), put before sudoku.js
+    //and the difficulty links; css hrefs are used as they are given
+    const char* root;
+    //url of a preview image (eg. from sudoku_thumb.h), adds og:title / og:image meta tags
+    //for link previews (they want an absolute url)
+    const char* image;
+} SudokuPageOptions;
+
+SudokuResult sudoku_write_html_page_ex(
+    const char* html_path,
+    const char* css_href,
+    const SudokuBoard* puzzle,
+    const SudokuBoard* out_solution,
+    const SudokuTheme* theme,
+    SudokuDifficulty difficulty,
+    const SudokuPageOptions* options
+);
+
+//writes the theme rules (what pages otherwise get as an inline <style> block) into dir as
+//theme-<hash>.css, the hash is of the content: all pages with one theme share one cached file,
+//and a changed theme gets a new name, so browsers never use a stale copy
+//dir: null or "" = current folder; out_name gets the file name (eg. for SudokuPageOptions.theme_css)
+SudokuResult sudoku_write_theme_css(const char* dir, const SudokuTheme* theme, char* out_name, size_t out_size);
+
 //utility: difficulty -> number of holes cell=0
 int sudoku_holes_for_difficulty(SudokuDifficulty difficulty);
 
+//utility: number of non 0 cells
+int sudoku_count_clues(const SudokuBoard* board);
+
+//puzzle text lines (puzzle files, miner output ...): 81 cells, '1'..'9', '0' or '.' = empty
+//reads the first 81 cells of line (stops at any other character); returns 1 if all 81 were there
+int sudoku_board_from_string(const char* line, SudokuBoard* out_board);
+//out82 gets 81 chars ('.' for empty) and a '\0'
+void sudoku_board_to_string(const SudokuBoard* board, char* out82);
+
+//files that are replaced whole (pages, stores, logs ...): write a temp file next to the real one,
+//then rename it over it, so readers (a web server, the next run) see the old file or the new one
+//whole, never half of one
+
+//temp name for path: "<path>.<pid>.tmp", so two programs writing one folder never share a temp file
+//returns 0 if it does not fit into out
+int sudoku_temp_path(const char* path, char* out, size_t out_size);
+
+//renames tmp over path; if that fails SUDOKU_ERR_IO is returned and both files are left as they are
+SudokuResult sudoku_replace_file(const char* tmp, const char* path);
+
+//for files that must survive a power cut (stores, logs): flushes f and its data to the disk
+//(before closing and sudoku_replace_file), then sudoku_sync_dir_of(path) makes the rename itself
+//stick (fsync of the folder; nothing to do on windows)
+SudokuResult sudoku_sync_file(FILE* f);
+SudokuResult sudoku_sync_dir_of(const char* path);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,369 @@
+// sudoku_site.c - navigation files of big static sites
+
+//mkdir is posix, not c99
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200112L
+#endif
+
+#include "sudoku_site.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#define make_dir(path) _mkdir(path)
+#else
+#include <sys/stat.h>
+#define make_dir(path) mkdir(path, 0755)
+#endif
+
+#define SITEMAP_HEADER "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<urlset xmlns=\"http://www.sitemaps.org/schemas/sitemap/0.9\">\n"
+#define SITEMAP_FOOTER "</urlset>\n"
+
+static char* dup_str(const char* s) {
+    if (!s) return NULL;
+    size_t n = strlen(s) + 1;
+    char* out = (char*)malloc(n);
+    if (out) memcpy(out, s, n);
+    return out;
+}
+
+static void site_path(const SudokuSiteIndex* site, char* out, size_t n, const char* name) {
+    if (site->dir && site->dir[0]) snprintf(out, n, "%s/%s", site->dir, name);
+    else snprintf(out, n, "%s", name);
+}
+
+static void index_name(int page, char* out, size_t n) {
+    if (page == 1) snprintf(out, n, "index.html");
+    else snprintf(out, n, "index-%d.html", page);
+}
+
+//html text / attribute value, also fine for xml
+static void fprint_escaped(FILE* f, const char* s) {
+    for (const char* p = s ? s : ""; *p; ++p) {
+        switch (*p) {
+            case '&': fputs("&amp;", f); break;
+            case '<': fputs("&lt;", f); break;
+            case '>': fputs("&gt;", f); break;
+            case '"': fputs("&quot;", f); break;
+            case '\'': fputs("&#39;", f); break;
+            default: fputc(*p, f); break;
+        }
+    }
+}
+
+static size_t escaped_len(const char* s) {
+    size_t n = 0;
+    for (const char* p = s ? s : ""; *p; ++p) {
+        switch (*p) {
+            case '&': n += 5; break;
+            case '<': case '>': n += 4; break;
+            case '"': case '\'': n += 6; break;
+            default: n += 1; break;
+        }
+    }
+    return n;
+}
+
+static void fprint_json_string(FILE* f, const char* s) {
+    fputc('"', f);
+    for (const char* p = s ? s : ""; *p; ++p) {
+        unsigned char ch = (unsigned char)*p;
+        if (ch == '"' || ch == '\\') fprintf(f, "\\%c", ch);
+        else if (ch < 0x20) fprintf(f, "\\u%04x", ch);
+        else fputc(ch, f);
+    }
+    fputc('"', f);
+}
+
+static const char* difficulty_name(int d) {
+    switch (d) {
+        case SUDOKU_DIFFICULTY_EASY: return "Easy";
+        case SUDOKU_DIFFICULTY_MEDIUM: return "Medium";
+        case SUDOKU_DIFFICULTY_HARD: return "Hard";
+        default: return NULL;
+    }
+}
+
+//every file is written to a temp file and renamed to <name> once finished, so a web server
+//serving the folder while the site is regenerated keeps sending the old file until the new one is whole
+static FILE* open_file(SudokuSiteIndex* site, const char* name) {
+    char path[1024], tmp[1040];
+    site_path(site, path, sizeof(path), name);
+    FILE* f = sudoku_temp_path(path, tmp, sizeof(tmp)) ? fopen(tmp, "w") : NULL;
+    if (!f) site->failed = 1;
+    return f;
+}
+
+static void close_file(SudokuSiteIndex* site, FILE** f, const char* name) {
+    if (!*f) return;
+    int ok = !ferror(*f);
+    if (fclose(*f) != 0) ok = 0;
+    *f = NULL;
+
+    char path[1024], tmp[1040];
+    site_path(site, path, sizeof(path), name);
+    sudoku_temp_path(path, tmp, sizeof(tmp));
+    if (!ok) remove(tmp);
+    if (!ok || sudoku_replace_file(tmp, path) != SUDOKU_OK) site->failed = 1;
+}
+
+//index pages
+
+static void start_index_page(SudokuSiteIndex* site) {
+    char name[64];
+    ++site->index_pages;
+    site->index_used = 0;
+    index_name(site->index_pages, name, sizeof(name));
+    site->index = open_file(site, name);
+    if (!site->index) return;
+    FILE* f = site->index;
+    fputs("<!DOCTYPE html>\n", f);
+    fputs("<html lang=\"en\">\n<head>\n", f);
+    fputs("  <meta charset=\"utf-8\">\n", f);
+    fputs("  <meta name=\"viewport\" content=\"width=device-width, initial-scale=1\">\n", f);
+    fputs("  <title>", f);
+    fprint_escaped(f, site->title);
+    if (site->index_pages > 1) fprintf(f, " (page %d)", site->index_pages);
+    fputs("</title>\n", f);
+    fputs("  <link rel=\"stylesheet\" href=\"", f);
+    fprint_escaped(f, site->css_href);
+    fputs("\">\n", f);
+    fputs("</head>\n<body>\n", f);
+    fputs("  <header><h1>", f);
+    fprint_escaped(f, site->title);
+    fputs("</h1><br><br></header>\n", f);
+    fputs("  <main>\n", f);
+    fputs("    <div class=\"difficulty\" style=\"width: 360px; height: auto;\">\n", f);
+    fputs("      <h2>Puzzles</h2>\n", f);
+    fprintf(f, "      <ol start=\"%ld\">\n", site->count + 1);
+}
+
+//has_next: the next index page exists (it is only known once its first link arrives)
+static void finish_index_page(SudokuSiteIndex* site, int has_next) {
+    FILE* f = site->index;
+    if (!f) return;
+    char name[64];
+    fputs("      </ol>\n", f);
+    fputs("      <p style=\"font-family: sans-serif; font-weight: 600;\">\n", f);
+    if (site->index_pages > 1) {
+        index_name(site->index_pages - 1, name, sizeof(name));
+        fprintf(f, "        <a href=\"%s\">&laquo; previous</a>\n", name);
+    }
+    fprintf(f, "        page %d\n", site->index_pages);
+    if (has_next) {
+        index_name(site->index_pages + 1, name, sizeof(name));
+        fprintf(f, "        <a href=\"%s\">next &raquo;</a>\n", name);
+    }
+    fputs("      </p>\n", f);
+    fputs("    </div>\n", f);
+    fputs("  </main>\n", f);
+    fputs("  <footer></footer>\n", f);
+    fputs("</body>\n</html>\n", f);
+    index_name(site->index_pages, name, sizeof(name));
+    close_file(site, &site->index, name);
+}
+
+//sitemaps
+
+static void start_sitemap(SudokuSiteIndex* site) {
+    char name[64];
+    ++site->sitemaps;
+    snprintf(name, sizeof(name), "sitemap-%d.xml", site->sitemaps);
+    site->sitemap = open_file(site, name);
+    site->sitemap_urls = 0;
+    site->sitemap_bytes = (long)strlen(SITEMAP_HEADER);
+    if (!site->sitemap) return;
+    fputs(SITEMAP_HEADER, site->sitemap);
+}
+
+static void finish_sitemap(SudokuSiteIndex* site) {
+    if (!site->sitemap) return;
+    char name[64];
+    snprintf(name, sizeof(name), "sitemap-%d.xml", site->sitemaps);
+    fputs(SITEMAP_FOOTER, site->sitemap);
+    close_file(site, &site->sitemap, name);
+}
+
+static void add_sitemap_url(SudokuSiteIndex* site, const char* href) {
+    //"  <loc>" + url + "</loc>" wrapped in <url> </url>, one line
+    long line = (long)(strlen("  <url><loc></loc></url>\n") + escaped_len(site->base_url) + escaped_len(href));
+    if (site->sitemap &&
+        (site->sitemap_urls >= SUDOKU_SITEMAP_MAX_URLS ||
+         site->sitemap_bytes + line + (long)strlen(SITEMAP_FOOTER) > SUDOKU_SITEMAP_MAX_BYTES)) {
+        finish_sitemap(site);
+    }
+    if (!site->sitemap) start_sitemap(site);
+    if (!site->sitemap) return;
+    fputs("  <url><loc>", site->sitemap);
+    fprint_escaped(site->sitemap, site->base_url);
+    fprint_escaped(site->sitemap, href);
+    fputs("</loc></url>\n", site->sitemap);
+    ++site->sitemap_urls;
+    site->sitemap_bytes += line;
+}
+
+static void write_sitemap_index(SudokuSiteIndex* site) {
+    FILE* f = open_file(site, "sitemap.xml");
+    if (!f) return;
+    fputs("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n", f);
+    fputs("<sitemapindex xmlns=\"http://www.sitemaps.org/schemas/sitemap/0.9\">\n", f);
+    for (int i = 1; i <= site->sitemaps; ++i) {
+        fputs("  <sitemap><loc>", f);
+        fprint_escaped(f, site->base_url);
+        fprintf(f, "sitemap-%d.xml</loc></sitemap>\n", i);
+    }
+    fputs("</sitemapindex>\n", f);
+    close_file(site, &f, "sitemap.xml");
+}
+
+SudokuResult sudoku_site_index_open(
+    SudokuSiteIndex* site,
+    const char* dir,
+    const char* base_url,
+    const char* title,
+    const char* css_href,
+    int per_page,
+    int shard
+) {
+    if (!site || per_page <= 0) return SUDOKU_ERR_INVALID_ARG;
+    memset(site, 0, sizeof(*site));
+    site->per_page = per_page;
+    site->shard = shard != 0;
+    site->dir = dup_str(dir ? dir : "");
+    site->title = dup_str(title ? title : "Sudoku");
+    site->css_href = dup_str(css_href ? css_href : "style.css");
+    if (base_url && base_url[0]) {
+        //urls are base_url + href, so the base needs its slash
+        size_t n = strlen(base_url);
+        site->base_url = (char*)malloc(n + 2);
+        if (site->base_url) {
+            memcpy(site->base_url, base_url, n + 1);
+            if (base_url[n - 1] != '/') memcpy(site->base_url + n, "/", 2);
+        }
+    }
+    if (!site->dir || !site->title || !site->css_href || (base_url && base_url[0] && !site->base_url)) {
+        site->failed = 1;
+        sudoku_site_index_close(site);
+        return SUDOKU_ERR_NO_MEMORY;
+    }
+
+    site->manifest = open_file(site, "manifest.json");
+    if (!site->manifest) {
+        sudoku_site_index_close(site);
+        return SUDOKU_ERR_IO;
+    }
+    fputs("{\"pages\": [\n", site->manifest);
+    return SUDOKU_OK;
+}
+
+static uint32_t hash_id(long id) {
+    //murmur3 finalizer, sequential ids spread over all folders
+    uint32_t h = (uint32_t)id;
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+}
+
+static int ensure_dir(const char* path) {
+    return make_dir(path) == 0 || errno == EEXIST;
+}
+
+SudokuResult sudoku_site_page_path(SudokuSiteIndex* site, long id, char* href, size_t href_size, char* path, size_t path_size) {
+    if (!site || !href || !path || href_size == 0 || path_size == 0) return SUDOKU_ERR_INVALID_ARG;
+    if (!site->shard) {
+        snprintf(href, href_size, "%ld.html", id);
+        site_path(site, path, path_size, href);
+        return SUDOKU_OK;
+    }
+
+    uint32_t h = hash_id(id);
+    unsigned a = (h >> 24) & 0xff, b = (h >> 16) & 0xff;
+    unsigned folder = a << 8 | b;
+    if (!(site->made[folder >> 3] & (1u << (folder & 7)))) {
+        char name[8];
+        snprintf(name, sizeof(name), "%02x", a);
+        site_path(site, path, path_size, name);
+        if (!ensure_dir(path)) return SUDOKU_ERR_IO;
+        snprintf(name, sizeof(name), "%02x/%02x", a, b);
+        site_path(site, path, path_size, name);
+        if (!ensure_dir(path)) return SUDOKU_ERR_IO;
+        site->made[folder >> 3] |= (unsigned char)(1u << (folder & 7));
+    }
+    snprintf(href, href_size, "%02x/%02x/%ld.html", a, b, id);
+    site_path(site, path, path_size, href);
+    return SUDOKU_OK;
+}
+
+const char* sudoku_site_page_root(const SudokuSiteIndex* site) {
+    return (site && site->shard) ? "../../" : "";
+}
+
+SudokuResult sudoku_site_index_add(SudokuSiteIndex* site, const SudokuSiteEntry* entry) {
+    if (!site || !entry || !entry->href || !site->manifest) return SUDOKU_ERR_INVALID_ARG;
+    const char* level = difficulty_name(entry->difficulty);
+
+    //index page
+    if (site->index && site->index_used == site->per_page) finish_index_page(site, 1);
+    if (!site->index) start_index_page(site);
+    if (site->index) {
+        FILE* f = site->index;
+        fputs("        <li><a href=\"", f);
+        fprint_escaped(f, entry->href);
+        fputs("\">", f);
+        fprint_escaped(f, entry->title ? entry->title : entry->href);
+        fputs("</a>", f);
+        if (level) fprintf(f, " %s", level);
+        if (entry->clues > 0) fprintf(f, ", %d clues", entry->clues);
+        fputs("</li>\n", f);
+        ++site->index_used;
+    }
+
+    if (site->base_url) add_sitemap_url(site, entry->href);
+
+    //manifest, one page per line
+    FILE* m = site->manifest;
+    fputs(site->count > 0 ? ",\n  {" : "  {", m);
+    fputs("\"href\": ", m);
+    fprint_json_string(m, entry->href);
+    if (entry->title) {
+        fputs(", \"title\": ", m);
+        fprint_json_string(m, entry->title);
+    }
+    if (level) fprintf(m, ", \"difficulty\": \"%s\"", level);
+    if (entry->clues > 0) fprintf(m, ", \"clues\": %d", entry->clues);
+    if (entry->score >= 0) fprintf(m, ", \"score\": %d", entry->score);
+    fputc('}', m);
+
+    ++site->count;
+    return site->failed ? SUDOKU_ERR_IO : SUDOKU_OK;
+}
+
+SudokuResult sudoku_site_index_close(SudokuSiteIndex* site) {
+    if (!site) return SUDOKU_ERR_INVALID_ARG;
+    if (site->manifest) {
+        //an empty site still gets its (empty) first index page
+        if (!site->index && site->index_pages == 0) start_index_page(site);
+        finish_index_page(site, 0);
+        if (site->base_url) {
+            finish_sitemap(site);
+            write_sitemap_index(site);
+        }
+        fprintf(site->manifest, "%s], \"count\": %ld, \"index_pages\": %d}\n",
+            site->count > 0 ? "\n" : "", site->count, site->index_pages);
+        close_file(site, &site->manifest, "manifest.json");
+    }
+    SudokuResult r = site->failed ? SUDOKU_ERR_IO : SUDOKU_OK;
+    free(site->dir);
+    free(site->base_url);
+    free(site->title);
+    free(site->css_href);
+    memset(site, 0, sizeof(*site));
+    return r;
+}
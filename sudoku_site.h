@@ -0,0 +1,92 @@
+// sudoku_site.h - navigation files of big static sites (index pages, sitemaps, manifest)
+
+//written in the same pass as the puzzle pages, one add per page:
+//  index.html, index-2.html, ...   links to per_page puzzles each, with prev / next
+//  sitemap-1.xml, sitemap-2.xml .. at most 50000 urls and 50 MB each (sitemap protocol limits)
+//  sitemap.xml                     sitemap index that lists them
+//  manifest.json                   one object per page (href, title, grade), one per line
+//sitemaps need absolute urls, so they are only written when there is a base url
+//memory stays the same for any number of pages: only the open files and counters are kept,
+//nothing is walked or re-read afterwards
+//each file is written to a temp file and renamed when finished (sudoku_replace_file), so a site can be regenerated
+//(new template or theme) in the folder a web server is serving from
+
+//sharded layout: hundreds of thousands of files in one folder make directory operations and
+//cdn sync tools crawl, so pages can go to ab/cd/<id>.html instead, where ab/cd are two bytes
+//of a hash of the id (65536 folders, a million pages is ~15 files per folder)
+
+#ifndef SUDOKU_SITE_H
+#define SUDOKU_SITE_H
+
+#include "sudoku_module.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SUDOKU_SITEMAP_MAX_URLS 50000
+#define SUDOKU_SITEMAP_MAX_BYTES (50L * 1024 * 1024)
+
+typedef struct SudokuSiteEntry {
+    const char* href;           // page path relative to the site root (eg. "123.html")
+    const char* title;
+    int difficulty;             // SudokuDifficulty, or -1 = unknown
+    int clues;
+    int score;                  // grader score, or -1 = unknown
+} SudokuSiteEntry;
+
+typedef struct SudokuSiteIndex {
+    char* dir;
+    char* base_url;             // null = no sitemaps
+    char* title;
+    char* css_href;
+    int per_page;
+
+    FILE* index;                // current index page
+    int index_pages;
+    int index_used;             // links on the current index page
+
+    FILE* sitemap;              // current sitemap file
+    int sitemaps;
+    int sitemap_urls;
+    long sitemap_bytes;
+
+    FILE* manifest;
+    long count;                 // pages added
+    int failed;                 // a write failed, close reports SUDOKU_ERR_IO
+
+    int shard;                  // pages go to ab/cd/<id>.html
+    unsigned char made[65536 / 8]; // shard folders created so far (bit per folder)
+} SudokuSiteIndex;
+
+//dir: output folder (must exist; null or "" = current), base_url: eg. "https://example.com/sudoku/"
+//or null, title / css_href: for the index pages, per_page: links per index page,
+//shard: nonzero = sharded page layout (see above)
+SudokuResult sudoku_site_index_open(
+    SudokuSiteIndex* site,
+    const char* dir,
+    const char* base_url,
+    const char* title,
+    const char* css_href,
+    int per_page,
+    int shard
+);
+
+//where page `id` goes: href relative to the site root ("123.html" or "ab/cd/123.html") and the
+//file path to write; creates the shard folders the first time they are needed
+SudokuResult sudoku_site_page_path(SudokuSiteIndex* site, long id, char* href, size_t href_size, char* path, size_t path_size);
+
+//path from a page to the site root ("" or "../../"), for SudokuPageOptions.root and css hrefs
+const char* sudoku_site_page_root(const SudokuSiteIndex* site);
+
+//adds one page to the index, the sitemap and the manifest
+SudokuResult sudoku_site_index_add(SudokuSiteIndex* site, const SudokuSiteEntry* entry);
+
+//finishes all files (last index page, last sitemap, sitemap index, manifest)
+SudokuResult sudoku_site_index_close(SudokuSiteIndex* site);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,427 @@
+// sudoku_store.c - binary puzzle store with indexes
+
+#include "sudoku_store.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+//record (48 bytes):
+//  0..40  puzzle, two cells per byte (low nibble first), 0 = empty
+//  41     clue count
+//  42     hardest technique
+//  43     techniques bitmask
+//  44..45 score (u16, clamped)
+//  46     flags, bit 0 = served
+//  47     0
+#define REC_CLUES 41
+#define REC_HARDEST 42
+#define REC_TECHNIQUES 43
+#define REC_SCORE 44
+#define REC_FLAGS 46
+
+#define STORE_VERSION 1
+#define HEADER_SIZE 64
+#define CLUE_SLOTS 83
+
+static void put_u32(unsigned char* p, uint32_t v) {
+    p[0] = (unsigned char)(v & 0xff);
+    p[1] = (unsigned char)((v >> 8) & 0xff);
+    p[2] = (unsigned char)((v >> 16) & 0xff);
+    p[3] = (unsigned char)((v >> 24) & 0xff);
+}
+
+static uint32_t get_u32(const unsigned char* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void put_u64(unsigned char* p, uint64_t v) {
+    put_u32(p, (uint32_t)(v & 0xffffffffu));
+    put_u32(p + 4, (uint32_t)(v >> 32));
+}
+
+static int host_is_little_endian(void) {
+    uint32_t one = 1;
+    return *(unsigned char*)&one == 1;
+}
+
+static size_t align8(size_t n) {
+    return (n + 7) & ~(size_t)7;
+}
+
+static int popcount64(uint64_t x) {
+    x = x - ((x >> 1) & 0x5555555555555555ull);
+    x = (x & 0x3333333333333333ull) + ((x >> 2) & 0x3333333333333333ull);
+    x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0full;
+    return (int)((x * 0x0101010101010101ull) >> 56);
+}
+
+void sudoku_store_pack(const SudokuStoreEntry* e, unsigned char* rec) {
+    memset(rec, 0, SUDOKU_STORE_RECORD_SIZE);
+    for (int i = 0; i < 81; ++i) {
+        int v = e->puzzle.cell[i / 9][i % 9] & 0x0f;
+        rec[i / 2] |= (unsigned char)((i & 1) ? v << 4 : v);
+    }
+    int score = e->grade.score;
+    if (score < 0) score = 0;
+    if (score > 0xffff) score = 0xffff;
+    rec[REC_CLUES] = (unsigned char)sudoku_count_clues(&e->puzzle);
+    rec[REC_HARDEST] = (unsigned char)e->grade.hardest;
+    rec[REC_TECHNIQUES] = (unsigned char)e->grade.techniques;
+    rec[REC_SCORE] = (unsigned char)(score & 0xff);
+    rec[REC_SCORE + 1] = (unsigned char)(score >> 8);
+    rec[REC_FLAGS] = (unsigned char)(e->served ? 1 : 0);
+}
+
+static int record_score(const unsigned char* rec) {
+    return rec[REC_SCORE] | (rec[REC_SCORE + 1] << 8);
+}
+
+typedef struct SortKey {
+    int clues;
+    int score;
+    uint32_t id;
+} SortKey;
+
+static int cmp_sort_key(const void* a, const void* b) {
+    const SortKey* x = (const SortKey*)a;
+    const SortKey* y = (const SortKey*)b;
+    if (x->clues != y->clues) return x->clues < y->clues ? -1 : 1;
+    if (x->score != y->score) return x->score < y->score ? -1 : 1;
+    return x->id < y->id ? -1 : (x->id > y->id);
+}
+
+void sudoku_store_query_init(SudokuStoreQuery* query) {
+    if (!query) return;
+    query->difficulty = -1;
+    query->min_clues = 0;
+    query->max_clues = 81;
+    query->min_score = 0;
+    query->max_score = 0xffff;
+    query->techniques = 0;
+    query->unserved_only = 0;
+}
+
+SudokuResult sudoku_store_write(const char* path, const SudokuStoreEntry* entries, int count) {
+    return sudoku_store_write_ex(path, entries, count, 0);
+}
+
+SudokuResult sudoku_store_write_ex(const char* path, const SudokuStoreEntry* entries, int count, uint32_t log_seq) {
+    if (!path || count < 0 || (count > 0 && !entries)) return SUDOKU_ERR_INVALID_ARG;
+
+    size_t n = (size_t)count;
+    size_t words = (n + 63) / 64;
+    size_t records_off = HEADER_SIZE;
+    size_t by_clues_off = records_off + n * SUDOKU_STORE_RECORD_SIZE;
+    size_t position_off = by_clues_off + n * 4;
+    size_t starts_off = position_off + n * 4;
+    size_t bitmaps_off = align8(starts_off + CLUE_SLOTS * 4);
+    size_t total = bitmaps_off + SUDOKU_STORE_BITMAPS * words * 8;
+
+    unsigned char* buf = (unsigned char*)calloc(1, total);
+    SortKey* keys = (SortKey*)malloc((n ? n : 1) * sizeof(SortKey));
+    uint64_t* bits = (uint64_t*)calloc(SUDOKU_STORE_BITMAPS * words + 1, sizeof(uint64_t));
+    if (!buf || !keys || !bits) {
+        free(buf);
+        free(keys);
+        free(bits);
+        return SUDOKU_ERR_NO_MEMORY;
+    }
+
+    memcpy(buf, "SDKS", 4);
+    put_u32(buf + 4, STORE_VERSION);
+    put_u32(buf + 8, (uint32_t)n);
+    put_u32(buf + 12, SUDOKU_STORE_RECORD_SIZE);
+    put_u32(buf + 16, (uint32_t)records_off);
+    put_u32(buf + 20, (uint32_t)by_clues_off);
+    put_u32(buf + 24, (uint32_t)position_off);
+    put_u32(buf + 28, (uint32_t)starts_off);
+    put_u32(buf + 32, (uint32_t)bitmaps_off);
+    put_u32(buf + 36, (uint32_t)words);
+    put_u32(buf + 40, log_seq);
+
+    for (size_t i = 0; i < n; ++i) {
+        unsigned char* rec = buf + records_off + i * SUDOKU_STORE_RECORD_SIZE;
+        sudoku_store_pack(&entries[i], rec);
+        keys[i].clues = rec[REC_CLUES];
+        keys[i].score = record_score(rec);
+        keys[i].id = (uint32_t)i;
+    }
+    qsort(keys, n, sizeof(SortKey), cmp_sort_key);
+
+    uint32_t starts[CLUE_SLOTS];
+    memset(starts, 0, sizeof(starts));
+    for (size_t pos = 0; pos < n; ++pos) {
+        uint32_t id = keys[pos].id;
+        put_u32(buf + by_clues_off + pos * 4, id);
+        put_u32(buf + position_off + (size_t)id * 4, (uint32_t)pos);
+        ++starts[keys[pos].clues + 1];
+
+        const SudokuStoreEntry* e = &entries[id];
+        uint64_t bit = (uint64_t)1 << (pos % 64);
+        for (int t = 0; t < SUDOKU_TECH_COUNT; ++t) {
+            if (e->grade.techniques & (1u << t)) bits[(size_t)t * words + pos / 64] |= bit;
+        }
+        int d = (int)sudoku_grade_difficulty(&e->grade);
+        bits[(size_t)(SUDOKU_TECH_COUNT + d) * words + pos / 64] |= bit;
+    }
+    //counts -> start offsets
+    for (int k = 1; k < CLUE_SLOTS; ++k) starts[k] += starts[k - 1];
+    for (int k = 0; k < CLUE_SLOTS; ++k) put_u32(buf + starts_off + (size_t)k * 4, starts[k]);
+    for (size_t w = 0; w < SUDOKU_STORE_BITMAPS * words; ++w) put_u64(buf + bitmaps_off + w * 8, bits[w]);
+
+    //write a temp file and rename it over the old store, so a crash never leaves half a store;
+    //data and rename are synced before returning, compaction resets its log right after this
+    SudokuResult res = SUDOKU_OK;
+    size_t tmp_size = strlen(path) + 32;
+    char* tmp = (char*)malloc(tmp_size);
+    FILE* f = NULL;
+    if (!tmp || !sudoku_temp_path(path, tmp, tmp_size)) {
+        res = SUDOKU_ERR_NO_MEMORY;
+    } else {
+        f = fopen(tmp, "wb");
+        if (!f) res = SUDOKU_ERR_IO;
+    }
+    if (f) {
+        if (fwrite(buf, 1, total, f) != total || sudoku_sync_file(f) != SUDOKU_OK) res = SUDOKU_ERR_IO;
+        if (fclose(f) != 0) res = SUDOKU_ERR_IO;
+        if (res != SUDOKU_OK) remove(tmp);
+    }
+    if (res == SUDOKU_OK) res = sudoku_replace_file(tmp, path);
+    if (res == SUDOKU_OK) res = sudoku_sync_dir_of(path);
+    free(tmp);
+    free(buf);
+    free(keys);
+    free(bits);
+    return res;
+}
+
+static void swap_u32_array(uint32_t* a, size_t n) {
+    for (size_t i = 0; i < n; ++i) a[i] = get_u32((const unsigned char*)&a[i]);
+}
+
+static void swap_u64_array(uint64_t* a, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        const unsigned char* p = (const unsigned char*)&a[i];
+        a[i] = (uint64_t)get_u32(p) | ((uint64_t)get_u32(p + 4) << 32);
+    }
+}
+
+//the indexes are used as array indexes by queries, so a damaged file must not get past open:
+//ids below count, starts never going down and never past count
+static int indexes_in_range(const uint32_t* by_clues, const uint32_t* position, const uint32_t* starts, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        if (by_clues[i] >= n || position[i] >= n) return 0;
+    }
+    for (int k = 0; k < CLUE_SLOTS; ++k) {
+        if (starts[k] > n || (k > 0 && starts[k] < starts[k - 1])) return 0;
+    }
+    return 1;
+}
+
+SudokuResult sudoku_store_open(SudokuStore* store, const char* path) {
+    if (!store || !path) return SUDOKU_ERR_INVALID_ARG;
+    memset(store, 0, sizeof(*store));
+
+    FILE* f = fopen(path, "rb");
+    if (!f) return SUDOKU_ERR_IO;
+    long size = -1;
+    if (fseek(f, 0, SEEK_END) == 0) size = ftell(f);
+    if (size < HEADER_SIZE || fseek(f, 0, SEEK_SET) != 0) {
+        fclose(f);
+        return SUDOKU_ERR_IO;
+    }
+
+    unsigned char* data = (unsigned char*)malloc((size_t)size);
+    if (!data) {
+        fclose(f);
+        return SUDOKU_ERR_NO_MEMORY;
+    }
+    size_t got = fread(data, 1, (size_t)size, f);
+    fclose(f);
+
+    size_t n = get_u32(data + 8);
+    size_t words = get_u32(data + 36);
+    size_t records_off = get_u32(data + 16);
+    size_t by_clues_off = get_u32(data + 20);
+    size_t position_off = get_u32(data + 24);
+    size_t starts_off = get_u32(data + 28);
+    size_t bitmaps_off = get_u32(data + 32);
+    int ok = got == (size_t)size &&
+             memcmp(data, "SDKS", 4) == 0 &&
+             get_u32(data + 4) == STORE_VERSION &&
+             get_u32(data + 12) == SUDOKU_STORE_RECORD_SIZE &&
+             words == (n + 63) / 64 &&
+             records_off + n * SUDOKU_STORE_RECORD_SIZE <= by_clues_off &&
+             by_clues_off + n * 4 <= position_off &&
+             position_off + n * 4 <= starts_off &&
+             starts_off + CLUE_SLOTS * 4 <= bitmaps_off &&
+             by_clues_off % 4 == 0 && position_off % 4 == 0 && starts_off % 4 == 0 &&
+             bitmaps_off % 8 == 0 &&
+             bitmaps_off + SUDOKU_STORE_BITMAPS * words * 8 <= (size_t)size;
+    if (!ok) {
+        free(data);
+        return SUDOKU_ERR_IO;
+    }
+
+    //all arrays are little endian on disk; only big endian hosts need to touch them
+    if (!host_is_little_endian()) {
+        swap_u32_array((uint32_t*)(data + by_clues_off), n);
+        swap_u32_array((uint32_t*)(data + position_off), n);
+        swap_u32_array((uint32_t*)(data + starts_off), CLUE_SLOTS);
+        swap_u64_array((uint64_t*)(data + bitmaps_off), SUDOKU_STORE_BITMAPS * words);
+    }
+    if (!indexes_in_range((const uint32_t*)(data + by_clues_off), (const uint32_t*)(data + position_off),
+                          (const uint32_t*)(data + starts_off), n)) {
+        free(data);
+        return SUDOKU_ERR_IO;
+    }
+
+    store->served = (uint64_t*)calloc(words + 1, sizeof(uint64_t));
+    if (!store->served) {
+        free(data);
+        return SUDOKU_ERR_NO_MEMORY;
+    }
+    store->data = data;
+    store->size = (size_t)size;
+    store->count = (int)n;
+    store->words = (int)words;
+    store->records = data + records_off;
+    store->by_clues = (const uint32_t*)(data + by_clues_off);
+    store->position = (const uint32_t*)(data + position_off);
+    store->starts = (const uint32_t*)(data + starts_off);
+    store->bitmaps = (const uint64_t*)(data + bitmaps_off);
+    store->log_seq = get_u32(data + 40);
+
+    for (size_t pos = 0; pos < n; ++pos) {
+        const unsigned char* rec = store->records + (size_t)store->by_clues[pos] * SUDOKU_STORE_RECORD_SIZE;
+        if (rec[REC_FLAGS] & 1) store->served[pos / 64] |= (uint64_t)1 << (pos % 64);
+    }
+
+    //served flags are written back in place; a read only file still works for queries
+    store->file = fopen(path, "r+b");
+    return SUDOKU_OK;
+}
+
+void sudoku_store_close(SudokuStore* store) {
+    if (!store) return;
+    if (store->file) fclose(store->file);
+    free(store->served);
+    free(store->data);
+    memset(store, 0, sizeof(*store));
+}
+
+static int score_at(const SudokuStore* s, uint32_t pos) {
+    return record_score(s->records + (size_t)s->by_clues[pos] * SUDOKU_STORE_RECORD_SIZE);
+}
+
+//first position in [lo, hi) whose score is >= score (the range is sorted by score)
+static uint32_t lower_bound_score(const SudokuStore* s, uint32_t lo, uint32_t hi, int score) {
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (score_at(s, mid) < score) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+//matching bits of one bitmap word
+static uint64_t match_word(const SudokuStore* s, const SudokuStoreQuery* q, size_t w) {
+    uint64_t m = ~(uint64_t)0;
+    for (int t = 0; t < SUDOKU_TECH_COUNT; ++t) {
+        if (q->techniques & (1u << t)) m &= s->bitmaps[(size_t)t * s->words + w];
+    }
+    if (q->difficulty >= 0) m &= s->bitmaps[(size_t)(SUDOKU_TECH_COUNT + q->difficulty) * s->words + w];
+    if (q->unserved_only) m &= ~s->served[w];
+    return m;
+}
+
+//counts matches; if want >= 0, returns the record id of match number `want` through out_id
+static long scan(const SudokuStore* s, const SudokuStoreQuery* q, long want, int* out_id) {
+    int lo_clues = q->min_clues < 0 ? 0 : q->min_clues;
+    int hi_clues = q->max_clues > 81 ? 81 : q->max_clues;
+    long found = 0;
+
+    for (int k = lo_clues; k <= hi_clues; ++k) {
+        uint32_t a = s->starts[k], b = s->starts[k + 1];
+        if (a == b) continue;
+        a = lower_bound_score(s, a, b, q->min_score);
+        b = lower_bound_score(s, a, b, q->max_score + 1);
+
+        //whole words in the middle, partial words at both ends
+        while (a < b) {
+            size_t w = a / 64;
+            uint32_t word_end = (uint32_t)(w + 1) * 64;
+            uint32_t end = b < word_end ? b : word_end;
+            uint64_t range = ~(uint64_t)0 << (a % 64);
+            if (end % 64) range &= ~(~(uint64_t)0 << (end % 64));
+            uint64_t m = match_word(s, q, w) & range;
+            int c = popcount64(m);
+            if (want >= 0 && found + c > want) {
+                for (long skip = want - found; skip > 0; --skip) m &= m - 1;
+                int bit = 0;
+                while (!(m & ((uint64_t)1 << bit))) ++bit;
+                *out_id = (int)s->by_clues[w * 64 + (size_t)bit];
+                return found + c;
+            }
+            found += c;
+            a = end;
+        }
+    }
+    return found;
+}
+
+static int query_ok(const SudokuStore* s, const SudokuStoreQuery* q) {
+    return s && q && s->data && q->difficulty <= (int)SUDOKU_DIFFICULTY_HARD;
+}
+
+int sudoku_store_count(const SudokuStore* store, const SudokuStoreQuery* query) {
+    if (!query_ok(store, query)) return -1;
+    return (int)scan(store, query, -1, NULL);
+}
+
+int sudoku_store_pick(const SudokuStore* store, const SudokuStoreQuery* query) {
+    if (!query_ok(store, query)) return -1;
+    long total = scan(store, query, -1, NULL);
+    if (total <= 0) return -1;
+
+    //RAND_MAX can be 32767, so use two calls for big stores
+    unsigned long r = (unsigned long)rand() * ((unsigned long)RAND_MAX + 1) + (unsigned long)rand();
+    int id = -1;
+    scan(store, query, (long)(r % (unsigned long)total), &id);
+    return id;
+}
+
+SudokuResult sudoku_store_get(const SudokuStore* store, int id, SudokuStoreEntry* out_entry) {
+    if (!store || !out_entry || id < 0 || id >= store->count) return SUDOKU_ERR_INVALID_ARG;
+    sudoku_store_unpack(store->records + (size_t)id * SUDOKU_STORE_RECORD_SIZE, out_entry);
+    return SUDOKU_OK;
+}
+
+void sudoku_store_unpack(const unsigned char* rec, SudokuStoreEntry* out_entry) {
+    memset(out_entry, 0, sizeof(*out_entry));
+    for (int i = 0; i < 81; ++i) {
+        int b = rec[i / 2];
+        out_entry->puzzle.cell[i / 9][i % 9] = (i & 1) ? b >> 4 : b & 0x0f;
+    }
+    out_entry->grade.score = record_score(rec);
+    out_entry->grade.hardest = rec[REC_HARDEST];
+    out_entry->grade.techniques = rec[REC_TECHNIQUES];
+    out_entry->served = rec[REC_FLAGS] & 1;
+}
+
+SudokuResult sudoku_store_mark_served(SudokuStore* store, int id) {
+    if (!store || !store->data || id < 0 || id >= store->count) return SUDOKU_ERR_INVALID_ARG;
+    uint32_t pos = store->position[id];
+    store->served[pos / 64] |= (uint64_t)1 << (pos % 64);
+
+    unsigned char* rec = store->data + (store->records - store->data) + (size_t)id * SUDOKU_STORE_RECORD_SIZE;
+    rec[REC_FLAGS] |= 1;
+    if (!store->file) return SUDOKU_ERR_IO;
+    long at = (long)((size_t)(rec - store->data) + REC_FLAGS);
+    if (fseek(store->file, at, SEEK_SET) != 0 ||
+        fputc(rec[REC_FLAGS], store->file) == EOF ||
+        fflush(store->file) != 0) {
+        return SUDOKU_ERR_IO;
+    }
+    return SUDOKU_OK;
+}
@@ -0,0 +1,103 @@
+// sudoku_store.h - binary puzzle store with indexes for range queries
+
+//one file holds the graded puzzles (48 byte records) and the indexes to find them
+//without scanning: record ids sorted by (clue count, score), a start table per clue
+//count and one bitmap per technique / difficulty over that sorted order
+//a query like "random unserved hard puzzle with x-wing and 23-25 clues" is then a few
+//binary searches plus AND-ing bitmap words over the matching ranges (microseconds)
+
+//the file is read in one go (fread, works the same everywhere) and the indexes are
+//used in place, nothing is rebuilt at open (only checked to point inside the file, a damaged one
+//is SUDOKU_ERR_IO); the store is only ever rewritten as a whole
+//(sudoku_store_write, or compaction of an ingestion log), only the "served" flags change in place
+
+//file layout (little endian):
+//  header   64 bytes: "SDKS", version, count, record size, section offsets, bitmap words,
+//           last ingestion log batch folded in (sudoku_log.h)
+//  records  count * 48 bytes (see sudoku_store.c)
+//  by_clues count * u32, record ids sorted by clues then score
+//  position count * u32, position of every record id in by_clues
+//  starts   83 * u32, by_clues[starts[k] .. starts[k+1]) have k clues
+//  bitmaps  SUDOKU_STORE_BITMAPS * words * u64, bit i is about by_clues[i]
+
+#ifndef SUDOKU_STORE_H
+#define SUDOKU_STORE_H
+
+#include "sudoku_module.h"
+#include "sudoku_grade.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SUDOKU_STORE_RECORD_SIZE 48
+
+//one bitmap per technique, then one per difficulty
+#define SUDOKU_STORE_BITMAPS (SUDOKU_TECH_COUNT + 3)
+
+typedef struct SudokuStoreEntry {
+    SudokuBoard puzzle;
+    //score, hardest and techniques are stored; uses[] is not (it comes back as zeros)
+    SudokuGrade grade;
+    int served;
+} SudokuStoreEntry;
+
+//read only for the caller, use the functions below
+typedef struct SudokuStore {
+    unsigned char* data;      // the whole file
+    size_t size;
+    int count;
+    int words;                // u64 words per bitmap
+    const unsigned char* records;
+    const uint32_t* by_clues;
+    const uint32_t* position;
+    const uint32_t* starts;
+    const uint64_t* bitmaps;
+    uint64_t* served;         // same order as the bitmaps, kept in sync with the file
+    FILE* file;               // open for writing the served flags
+    uint32_t log_seq;         // last ingestion log batch in this store, 0 = none
+} SudokuStore;
+
+typedef struct SudokuStoreQuery {
+    int difficulty;           // SudokuDifficulty, or -1 = any
+    int min_clues, max_clues;
+    int min_score, max_score;
+    unsigned int techniques;  // all of these bits must be set (bit t = SudokuTechnique t)
+    int unserved_only;
+} SudokuStoreQuery;
+
+//query that matches every puzzle
+void sudoku_store_query_init(SudokuStoreQuery* query);
+
+//writes a new store file with the indexes (replaces the file through a temp file + rename)
+SudokuResult sudoku_store_write(const char* path, const SudokuStoreEntry* entries, int count);
+
+//same, and records the last ingestion log batch it contains (used by sudoku_log_compact)
+SudokuResult sudoku_store_write_ex(const char* path, const SudokuStoreEntry* entries, int count, uint32_t log_seq);
+
+//one entry <-> SUDOKU_STORE_RECORD_SIZE bytes (the ingestion log uses the same records)
+void sudoku_store_pack(const SudokuStoreEntry* entry, unsigned char* rec);
+void sudoku_store_unpack(const unsigned char* rec, SudokuStoreEntry* out_entry);
+
+SudokuResult sudoku_store_open(SudokuStore* store, const char* path);
+void sudoku_store_close(SudokuStore* store);
+
+//how many puzzles match, -1 for invalid args
+int sudoku_store_count(const SudokuStore* store, const SudokuStoreQuery* query);
+
+//random matching record id (uses rand()), or -1 if nothing matches
+int sudoku_store_pick(const SudokuStore* store, const SudokuStoreQuery* query);
+
+SudokuResult sudoku_store_get(const SudokuStore* store, int id, SudokuStoreEntry* out_entry);
+
+//marks a puzzle as served, in memory and in the file (one byte write)
+SudokuResult sudoku_store_mark_served(SudokuStore* store, int id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,713 @@
+// sudoku_template.c - user supplied html page templates
+
+//writev/open are posix, not c99
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200112L
+#endif
+
+#include "sudoku_template.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+//iovecs per writev call (pages have ~20 parts, IOV_MAX is 1024 on linux)
+#if defined(IOV_MAX) && IOV_MAX < 64
+#define PAGE_IOV_MAX IOV_MAX
+#else
+#define PAGE_IOV_MAX 64
+#endif
+
+static const char* const slot_names[SUDOKU_SLOT_COUNT] = {
+    "title", "css", "style", "solution", "cells", "difficulty", "level", "replay", "leaderboard", "root", "image"
+};
+
+//block slots write whole lines (see sudoku_template.h)
+static int slot_is_block(int slot) {
+    return slot == SUDOKU_SLOT_STYLE || slot == SUDOKU_SLOT_CELLS || slot == SUDOKU_SLOT_DIFFICULTY ||
+           slot == SUDOKU_SLOT_REPLAY || slot == SUDOKU_SLOT_LEADERBOARD || slot == SUDOKU_SLOT_IMAGE;
+}
+
+static const char default_text[] =
+    "<!DOCTYPE html>\n"
+    "<html lang=\"en\">\n"
+    "<head>\n"
+    "    <meta charset=\"utf-8\">\n"
+    "    <meta name=\"viewport\" content=\"width=device-width, initial-scale=1\">\n"
+    "    <title>{{title}}</title>\n"
+    "    <link rel=\"stylesheet\" href=\"{{css}}\">\n"
+    "    <script src=\"{{root}}sudoku.js\" defer></script>\n"
+    "    {{image}}\n"
+    "    {{style}}\n"
+    "</head>\n"
+    "<body>\n"
+    "    <header>\n"
+    "        <h1>{{title}}</h1>\n"
+    "        <br><br>\n"
+    "    </header>\n"
+    "    <main>\n"
+    "        <div class=\"game\">\n"
+    "            <div class=\"score\">\n"
+    "                <div class=\"time\">Time: 10:00</div>\n"
+    "                <div class=\"points\">Score: 0</div>\n"
+    "                <div class=\"mistakes\">Mistakes: 0/3</div>\n"
+    "            </div>\n"
+    "            <div class=\"container\"{{solution}}>\n"
+    "                {{cells}}\n"
+    "            </div>\n"
+    "        </div>\n"
+    "        <div class=\"difficulty\">\n"
+    "            <h2>Difficulty</h2>\n"
+    "            <ul>\n"
+    "                {{difficulty}}\n"
+    "            </ul>\n"
+    "            <div class=\"buttons\">\n"
+    "                <button class=\"b\" data-action=\"start\">Start</button>\n"
+    "                <button class=\"b\" data-action=\"pause\">Pause</button>\n"
+    "                <button class=\"b\" data-action=\"reset\">Reset</button>\n"
+    "                {{replay}}\n"
+    "            </div>\n"
+    "        </div>\n"
+    "        <div class=\"leaderboard\">\n"
+    "            <h2>Leaderboard</h2>\n"
+    "            <ol>\n"
+    "                {{leaderboard}}\n"
+    "            </ol>\n"
+    "        </div>\n"
+    "    </main>\n"
+    "    <footer></footer>\n"
+    "</body>\n"
+    "</html>\n";
+
+const char* sudoku_template_default_text(void) {
+    return default_text;
+}
+
+void sudoku_template_free(SudokuTemplate* tpl) {
+    if (!tpl) return;
+    free(tpl->text);
+    free(tpl->ops);
+    memset(tpl, 0, sizeof(*tpl));
+}
+
+static int line_of(const char* text, const char* p) {
+    int line = 1;
+    for (const char* q = text; q < p; ++q) {
+        if (*q == '\n') ++line;
+    }
+    return line;
+}
+
+//adds a text op (empty spans are skipped, a span right after another text span is merged)
+static void add_text(SudokuTemplate* tpl, size_t offset, size_t len) {
+    if (len == 0) return;
+    SudokuTemplateOp* last = tpl->count > 0 ? &tpl->ops[tpl->count - 1] : NULL;
+    if (last && last->slot == SUDOKU_SLOT_TEXT && last->offset + last->len == offset) {
+        last->len += len;
+        return;
+    }
+    SudokuTemplateOp* op = &tpl->ops[tpl->count++];
+    op->slot = SUDOKU_SLOT_TEXT;
+    op->offset = offset;
+    op->len = len;
+}
+
+SudokuResult sudoku_template_compile(SudokuTemplate* tpl, const char* text) {
+    if (!tpl || !text) return SUDOKU_ERR_INVALID_ARG;
+    memset(tpl, 0, sizeof(*tpl));
+
+    size_t n = strlen(text);
+    tpl->text = (char*)malloc(n + 1);
+    if (!tpl->text) return SUDOKU_ERR_NO_MEMORY;
+    memcpy(tpl->text, text, n + 1);
+
+    //every placeholder makes at most one slot op + one text op after it
+    int max_ops = 1;
+    for (const char* p = strstr(tpl->text, "{{"); p; p = strstr(p + 2, "{{")) max_ops += 2;
+    tpl->ops = (SudokuTemplateOp*)malloc((size_t)max_ops * sizeof(SudokuTemplateOp));
+    if (!tpl->ops) {
+        sudoku_template_free(tpl);
+        return SUDOKU_ERR_NO_MEMORY;
+    }
+
+    const char* s = tpl->text;
+    size_t pos = 0;
+    for (;;) {
+        const char* open = strstr(s + pos, "{{");
+        if (!open) break;
+        const char* name = open + 2;
+        const char* close = strstr(name, "}}");
+        int slot = -1;
+        if (close) {
+            for (int i = 0; i < SUDOKU_SLOT_COUNT; ++i) {
+                size_t len = strlen(slot_names[i]);
+                if ((size_t)(close - name) == len && strncmp(name, slot_names[i], len) == 0) slot = i;
+            }
+        }
+        if (slot < 0) {
+            int line = line_of(s, open);
+            sudoku_template_free(tpl);
+            tpl->error_line = line;
+            return SUDOKU_ERR_INVALID_ARG;
+        }
+
+        size_t start = (size_t)(open - s);
+        size_t end = (size_t)(close + 2 - s);
+        if (slot_is_block(slot)) {
+            //alone on its line: drop the indentation before and the newline after
+            size_t ls = start;
+            while (ls > pos && (s[ls - 1] == ' ' || s[ls - 1] == '\t')) --ls;
+            size_t le = end;
+            while (s[le] == ' ' || s[le] == '\t' || s[le] == '\r') ++le;
+            if ((ls == 0 || s[ls - 1] == '\n') && (s[le] == '\n' || s[le] == '\0')) {
+                start = ls;
+                end = s[le] == '\n' ? le + 1 : le;
+            }
+        }
+        add_text(tpl, pos, start - pos);
+        tpl->ops[tpl->count].slot = slot;
+        tpl->ops[tpl->count].offset = 0;
+        tpl->ops[tpl->count].len = 0;
+        ++tpl->count;
+        pos = end;
+    }
+    add_text(tpl, pos, n - pos);
+    return SUDOKU_OK;
+}
+
+SudokuResult sudoku_template_load(SudokuTemplate* tpl, const char* path) {
+    if (!tpl || !path) return SUDOKU_ERR_INVALID_ARG;
+    memset(tpl, 0, sizeof(*tpl));
+
+    FILE* f = fopen(path, "rb");
+    if (!f) return SUDOKU_ERR_IO;
+    long size = -1;
+    if (fseek(f, 0, SEEK_END) == 0) size = ftell(f);
+    if (size < 0 || fseek(f, 0, SEEK_SET) != 0) {
+        fclose(f);
+        return SUDOKU_ERR_IO;
+    }
+    char* text = (char*)malloc((size_t)size + 1);
+    if (!text) {
+        fclose(f);
+        return SUDOKU_ERR_NO_MEMORY;
+    }
+    size_t got = fread(text, 1, (size_t)size, f);
+    fclose(f);
+    if (got != (size_t)size) {
+        free(text);
+        return SUDOKU_ERR_IO;
+    }
+    text[got] = '\0';
+
+    SudokuResult r = sudoku_template_compile(tpl, text);
+    free(text);
+    return r;
+}
+
+//page parts
+
+void sudoku_page_parts_init(SudokuPageParts* page) {
+    if (!page) return;
+    memset(page, 0, sizeof(*page));
+}
+
+void sudoku_page_parts_free(SudokuPageParts* page) {
+    if (!page) return;
+    free(page->parts);
+    free(page->bytes);
+    memset(page, 0, sizeof(*page));
+}
+
+static SudokuPagePart* new_part(SudokuPageParts* page) {
+    if (page->count == page->cap) {
+        int ncap = page->cap ? page->cap * 2 : 32;
+        SudokuPagePart* np = (SudokuPagePart*)realloc(page->parts, (size_t)ncap * sizeof(SudokuPagePart));
+        if (!np) {
+            page->failed = 1;
+            return NULL;
+        }
+        page->parts = np;
+        page->cap = ncap;
+    }
+    return &page->parts[page->count++];
+}
+
+//template text is referenced, not copied
+static void add_shared(SudokuPageParts* page, const char* text, size_t len) {
+    SudokuPagePart* part = new_part(page);
+    if (!part) return;
+    part->text = text;
+    part->offset = 0;
+    part->len = len;
+}
+
+//per page bytes go to the page buffer; consecutive ones share one part
+static void put(SudokuPageParts* page, const char* s, size_t n) {
+    if (n == 0 || page->failed) return;
+    if (page->bytes_len + n > page->bytes_cap) {
+        size_t ncap = page->bytes_cap ? page->bytes_cap * 2 : 1024;
+        while (ncap < page->bytes_len + n) ncap *= 2;
+        char* nb = (char*)realloc(page->bytes, ncap);
+        if (!nb) {
+            page->failed = 1;
+            return;
+        }
+        page->bytes = nb;
+        page->bytes_cap = ncap;
+    }
+    memcpy(page->bytes + page->bytes_len, s, n);
+
+    SudokuPagePart* last = page->count > 0 ? &page->parts[page->count - 1] : NULL;
+    if (last && !last->text) {
+        last->len += n;
+    } else {
+        last = new_part(page);
+        if (!last) return;
+        last->text = NULL;
+        last->offset = page->bytes_len;
+        last->len = n;
+    }
+    page->bytes_len += n;
+}
+
+static void puts_page(SudokuPageParts* page, const char* s) {
+    put(page, s, strlen(s));
+}
+
+static void putc_page(SudokuPageParts* page, char ch) {
+    put(page, &ch, 1);
+}
+
+//slot writers (the only code that writes page html; sudoku_write_html_page_ex goes through here too)
+
+static void put_html_escaped(SudokuPageParts* page, const char* s) {
+    for (const char* p = s ? s : ""; *p; ++p) {
+        switch (*p) {
+            case '&': puts_page(page, "&amp;"); break;
+            case '<': puts_page(page, "&lt;"); break;
+            case '>': puts_page(page, "&gt;"); break;
+            case '"': puts_page(page, "&quot;"); break;
+            case '\'': puts_page(page, "&#39;"); break;
+            default: putc_page(page, *p); break;
+        }
+    }
+}
+
+static void put_filtered(SudokuPageParts* page, const char* s, const char* extra) {
+    //letters, digits and the extra characters only (css values, base64)
+    for (const char* p = s ? s : ""; *p; ++p) {
+        char ch = *p;
+        if ((ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || (ch >= '0' && ch <= '9') || strchr(extra, ch)) {
+            putc_page(page, ch);
+        }
+    }
+}
+
+#define CSS_EXTRA "#(),.% -_"
+#define BASE64_EXTRA "+/="
+
+static int board_is_filled_1_9(const SudokuBoard* b) {
+    if (!b) return 0;
+    for (int r = 0; r < 9; ++r) {
+        for (int c = 0; c < 9; ++c) {
+            if (b->cell[r][c] < 1 || b->cell[r][c] > 9) return 0;
+        }
+    }
+    return 1;
+}
+
+//the theme rules, for the inline <style> block and for sudoku_write_theme_css() alike,
+//so a theme-<hash>.css file always holds exactly what the page would have inlined
+static void put_theme_rules(SudokuPageParts* page, const SudokuTheme* theme, const char* indent) {
+    if (theme && (theme->panel_bg || theme->cell_hover_bg)) {
+        if (theme->panel_bg) {
+            puts_page(page, indent);
+            puts_page(page, "header h1, main .game, main .difficulty, main .leaderboard { background-color: ");
+            put_filtered(page, theme->panel_bg, CSS_EXTRA);
+            puts_page(page, "; }\n");
+        }
+        if (theme->cell_hover_bg) {
+            puts_page(page, indent);
+            puts_page(page, "main .game .container .cell:hover { background-color: ");
+            put_filtered(page, theme->cell_hover_bg, CSS_EXTRA);
+            puts_page(page, "; }\n");
+        }
+        //make given cells stand out a bit
+        puts_page(page, indent);
+        puts_page(page, ".cell.given { display:flex; align-items:center; justify-content:center; font-weight:bold; font-size: 1.2em; }\n");
+        puts_page(page, indent);
+        puts_page(page, ".cell.empty { display:flex; align-items:center; justify-content:center; color:#666; }\n");
+    } else {
+        puts_page(page, indent);
+        puts_page(page, ".cell { display:flex; align-items:center; justify-content:center; font-weight:bold; font-size: 1.2em; }\n");
+        puts_page(page, indent);
+        puts_page(page, ".cell.empty { font-weight: normal; color:#666; }\n");
+    }
+}
+
+static void put_style(SudokuPageParts* page, const SudokuTheme* theme, const char* theme_css) {
+    if (theme_css) {
+        //shared theme-<hash>.css (sudoku_write_theme_css)
+        puts_page(page, "    <link rel=\"stylesheet\" href=\"");
+        put_html_escaped(page, theme_css);
+        puts_page(page, "\">\n");
+        return;
+    }
+    puts_page(page, "    <style>\n");
+    put_theme_rules(page, theme, "      ");
+    puts_page(page, "    </style>\n");
+}
+
+static char puzzle_char(int v, char empty) {
+    return (v >= 1 && v <= 9) ? (char)('0' + v) : empty;
+}
+
+static void put_cells(SudokuPageParts* page, const SudokuBoard* puzzle, int compact) {
+    if (compact) {
+        //no-js fallback only, sudoku.js builds the cells from data-puzzle
+        char grid[9 * 12];
+        size_t n = 0;
+        for (int r = 0; r < 9; ++r) {
+            if (r > 0) grid[n++] = '\n';
+            for (int c = 0; c < 9; ++c) {
+                if (c == 3 || c == 6) grid[n++] = ' ';
+                grid[n++] = puzzle_char(puzzle->cell[r][c], '.');
+            }
+        }
+        puts_page(page, "                <noscript><pre class=\"puzzle-text\">");
+        put(page, grid, n);
+        puts_page(page, "</pre></noscript>\n");
+        return;
+    }
+    for (int r = 0; r < 9; ++r) {
+        for (int c = 0; c < 9; ++c) {
+            int v = puzzle->cell[r][c];
+            if (v == 0) {
+                puts_page(page, "                <div class=\"cell empty\"></div>\n");
+            } else {
+                puts_page(page, "                <div class=\"cell given\">");
+                putc_page(page, (char)('0' + v));
+                puts_page(page, "</div>\n");
+            }
+        }
+    }
+}
+
+static const char* const level_names[3] = {"Easy", "Medium", "Hard"};
+static const char* const level_files[3] = {"sudoku_easy.html", "sudoku_medium.html", "sudoku_hard.html"};
+
+static int level_index(SudokuDifficulty d) {
+    return (d >= SUDOKU_DIFFICULTY_EASY && d <= SUDOKU_DIFFICULTY_HARD) ? (int)d : SUDOKU_DIFFICULTY_MEDIUM;
+}
+
+static void put_difficulty(SudokuPageParts* page, SudokuDifficulty difficulty, const char* root) {
+    int current = level_index(difficulty);
+    for (int i = 0; i < 3; ++i) {
+        puts_page(page, "                <li");
+        if (i == current) puts_page(page, " class=\"active\"");
+        puts_page(page, "><a href=\"");
+        put_html_escaped(page, root);
+        puts_page(page, level_files[i]);
+        puts_page(page, "\">");
+        puts_page(page, level_names[i]);
+        puts_page(page, "</a></li>\n");
+    }
+}
+
+static void put_leaderboard(SudokuPageParts* page) {
+    //still static, same names as the built-in page
+    static const char* const names[] = {
+        "Malunke", "Andrius", "Adomas", "Irmantas", "Arvydas", "Luna", "Gabija", "Augustas", "Kostas", "Justas"
+    };
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); ++i) {
+        puts_page(page, "                <li>");
+        puts_page(page, names[i]);
+        puts_page(page, "</li>\n");
+    }
+}
+
+SudokuResult sudoku_template_render(
+    const SudokuTemplate* tpl,
+    SudokuPageParts* page,
+    const char* css_href,
+    const SudokuBoard* puzzle,
+    const SudokuBoard* out_solution,
+    const SudokuTheme* theme,
+    SudokuDifficulty difficulty,
+    const SudokuPageOptions* options
+) {
+    if (!tpl || !tpl->ops || !page || !css_href || !puzzle) return SUDOKU_ERR_INVALID_ARG;
+    page->count = 0;
+    page->bytes_len = 0;
+    page->failed = 0;
+
+    const char* trace = (options && options->trace && options->trace[0]) ? options->trace : NULL;
+    const char* title = (theme && theme->page_title) ? theme->page_title : "Sudoku";
+    const int compact = options && options->compact;
+    const char* theme_css = (options && options->theme_css && options->theme_css[0]) ? options->theme_css : NULL;
+    const char* root = (options && options->root) ? options->root : "";
+    const char* image = (options && options->image && options->image[0]) ? options->image : NULL;
+
+    for (int i = 0; i < tpl->count; ++i) {
+        const SudokuTemplateOp* op = &tpl->ops[i];
+        switch (op->slot) {
+            case SUDOKU_SLOT_TEXT: add_shared(page, tpl->text + op->offset, op->len); break;
+            case SUDOKU_SLOT_TITLE: put_html_escaped(page, title); break;
+            case SUDOKU_SLOT_CSS: put_html_escaped(page, css_href); break;
+            case SUDOKU_SLOT_STYLE: put_style(page, theme, theme_css); break;
+            case SUDOKU_SLOT_SOLUTION:
+                if (compact) {
+                    char digits[81];
+                    for (int k = 0; k < 81; ++k) digits[k] = puzzle_char(puzzle->cell[k / 9][k % 9], '0');
+                    puts_page(page, " data-puzzle=\"");
+                    put(page, digits, sizeof(digits));
+                    puts_page(page, "\"");
+                }
+                if (out_solution && board_is_filled_1_9(out_solution)) {
+                    char digits[81];
+                    for (int k = 0; k < 81; ++k) digits[k] = (char)('0' + out_solution->cell[k / 9][k % 9]);
+                    puts_page(page, " data-solution=\"");
+                    put(page, digits, sizeof(digits));
+                    puts_page(page, "\"");
+                }
+                if (trace) {
+                    puts_page(page, " data-trace=\"");
+                    put_filtered(page, trace, BASE64_EXTRA);
+                    puts_page(page, "\"");
+                }
+                break;
+            case SUDOKU_SLOT_CELLS: put_cells(page, puzzle, compact); break;
+            case SUDOKU_SLOT_DIFFICULTY: put_difficulty(page, difficulty, root); break;
+            case SUDOKU_SLOT_LEVEL: puts_page(page, level_names[level_index(difficulty)]); break;
+            case SUDOKU_SLOT_REPLAY:
+                if (trace) puts_page(page, "                <button class=\"b\" data-action=\"replay\">Show me</button>\n");
+                break;
+            case SUDOKU_SLOT_LEADERBOARD: put_leaderboard(page); break;
+            case SUDOKU_SLOT_ROOT: put_html_escaped(page, root); break;
+            case SUDOKU_SLOT_IMAGE:
+                if (image) {
+                    puts_page(page, "    <meta property=\"og:title\" content=\"");
+                    put_html_escaped(page, title);
+                    puts_page(page, "\">\n    <meta property=\"og:image\" content=\"");
+                    put_html_escaped(page, image);
+                    puts_page(page, "\">\n");
+                }
+                break;
+            default: break;
+        }
+    }
+    return page->failed ? SUDOKU_ERR_NO_MEMORY : SUDOKU_OK;
+}
+
+size_t sudoku_page_parts_size(const SudokuPageParts* page) {
+    size_t total = 0;
+    for (int i = 0; page && i < page->count; ++i) total += page->parts[i].len;
+    return total;
+}
+
+static const char* part_data(const SudokuPageParts* page, const SudokuPagePart* part) {
+    return part->text ? part->text + part->offset : page->bytes + part->offset;
+}
+
+SudokuResult sudoku_page_parts_write(const SudokuPageParts* page, FILE* f) {
+    if (!page || !f) return SUDOKU_ERR_INVALID_ARG;
+    for (int i = 0; i < page->count; ++i) {
+        const SudokuPagePart* part = &page->parts[i];
+        if (fwrite(part_data(page, part), 1, part->len, f) != part->len) return SUDOKU_ERR_IO;
+    }
+    return SUDOKU_OK;
+}
+
+#ifdef _WIN32
+
+SudokuResult sudoku_page_parts_write_fd(const SudokuPageParts* page, int fd) {
+    //no writev here, one _write per part
+    if (!page || fd < 0) return SUDOKU_ERR_INVALID_ARG;
+    for (int i = 0; i < page->count; ++i) {
+        const char* p = part_data(page, &page->parts[i]);
+        size_t left = page->parts[i].len;
+        while (left > 0) {
+            int n = _write(fd, p, (unsigned int)(left > 0x40000000u ? 0x40000000u : left));
+            if (n <= 0) return SUDOKU_ERR_IO;
+            p += n;
+            left -= (size_t)n;
+        }
+    }
+    return SUDOKU_OK;
+}
+
+#else
+
+SudokuResult sudoku_page_parts_write_fd(const SudokuPageParts* page, int fd) {
+    if (!page || fd < 0) return SUDOKU_ERR_INVALID_ARG;
+    struct iovec iov[PAGE_IOV_MAX];
+    int next = 0;       // first part not handed to writev yet
+    size_t skip = 0;    // bytes of parts[next] already written
+    while (next < page->count) {
+        int n = 0;
+        for (int i = next; i < page->count && n < PAGE_IOV_MAX; ++i, ++n) {
+            size_t off = i == next ? skip : 0;
+            iov[n].iov_base = (void*)(part_data(page, &page->parts[i]) + off);
+            iov[n].iov_len = page->parts[i].len - off;
+        }
+        ssize_t w = writev(fd, iov, n);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) return SUDOKU_ERR_IO;
+        //short write: move past what went out
+        size_t done = (size_t)w;
+        while (next < page->count && done >= page->parts[next].len - skip) {
+            done -= page->parts[next].len - skip;
+            skip = 0;
+            ++next;
+        }
+        skip += done;
+    }
+    return SUDOKU_OK;
+}
+
+#endif
+
+SudokuResult sudoku_page_parts_write_file(const SudokuPageParts* page, const char* path) {
+    if (!page || !path) return SUDOKU_ERR_INVALID_ARG;
+
+    //the page goes to a temp file renamed over the old one, so a server reading the folder while
+    //it is regenerated (new template / theme) gets either version whole
+    char tmp_path[1040];
+    if (!sudoku_temp_path(path, tmp_path, sizeof(tmp_path))) return SUDOKU_ERR_INVALID_ARG;
+#ifdef _WIN32
+    int fd = _open(tmp_path, _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+    int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+#endif
+    if (fd < 0) return SUDOKU_ERR_IO;
+    SudokuResult r = sudoku_page_parts_write_fd(page, fd);
+#ifdef _WIN32
+    if (_close(fd) != 0) r = SUDOKU_ERR_IO;
+#else
+    if (close(fd) != 0) r = SUDOKU_ERR_IO;
+#endif
+    if (r != SUDOKU_OK) {
+        remove(tmp_path);
+        return r;
+    }
+    return sudoku_replace_file(tmp_path, path);
+}
+
+SudokuResult sudoku_template_write_page(
+    const SudokuTemplate* tpl,
+    const char* html_path,
+    const char* css_href,
+    const SudokuBoard* puzzle,
+    const SudokuBoard* out_solution,
+    const SudokuTheme* theme,
+    SudokuDifficulty difficulty,
+    const SudokuPageOptions* options
+) {
+    if (!html_path) return SUDOKU_ERR_INVALID_ARG;
+
+    SudokuPageParts page;
+    sudoku_page_parts_init(&page);
+    SudokuResult r = sudoku_template_render(tpl, &page, css_href, puzzle, out_solution, theme, difficulty, options);
+    if (r != SUDOKU_OK) {
+        sudoku_page_parts_free(&page);
+        return r;
+    }
+
+    r = sudoku_page_parts_write_file(&page, html_path);
+    sudoku_page_parts_free(&page);
+    return r;
+}
+
+//page writers declared in sudoku_module.h
+
+SudokuResult sudoku_write_html_page(
+    const char* html_path,
+    const char* css_href,
+    const SudokuBoard* puzzle,
+    const SudokuTheme* theme,
+    SudokuDifficulty difficulty
+) {
+    return sudoku_write_html_page_with_solution(
+        html_path, css_href, puzzle, NULL, theme, difficulty
+    );
+}
+
+SudokuResult sudoku_write_html_page_with_solution(
+    const char* html_path,
+    const char* css_href,
+    const SudokuBoard* puzzle,
+    const SudokuBoard* out_solution,
+    const SudokuTheme* theme,
+    SudokuDifficulty difficulty
+) {
+    return sudoku_write_html_page_ex(
+        html_path, css_href, puzzle, out_solution, theme, difficulty, NULL
+    );
+}
+
+//the page layout lives in one place, the built-in template; it is compiled for every page
+//(~1 us, next to nothing beside writing the file) so there is no shared state between threads
+SudokuResult sudoku_write_html_page_ex(
+    const char* html_path,
+    const char* css_href,
+    const SudokuBoard* puzzle,
+    const SudokuBoard* out_solution,
+    const SudokuTheme* theme,
+    SudokuDifficulty difficulty,
+    const SudokuPageOptions* options
+) {
+    if (!html_path || !css_href || !puzzle) return SUDOKU_ERR_INVALID_ARG;
+    SudokuTemplate tpl;
+    SudokuResult r = sudoku_template_compile(&tpl, sudoku_template_default_text());
+    if (r != SUDOKU_OK) return r;
+    r = sudoku_template_write_page(&tpl, html_path, css_href, puzzle, out_solution, theme, difficulty, options);
+    sudoku_template_free(&tpl);
+    return r;
+}
+
+static void join_path(char* out, size_t n, const char* dir, const char* name) {
+    if (dir && dir[0]) snprintf(out, n, "%s/%s", dir, name);
+    else snprintf(out, n, "%s", name);
+}
+
+SudokuResult sudoku_write_theme_css(const char* dir, const SudokuTheme* theme, char* out_name, size_t out_size) {
+    if (!out_name || out_size < sizeof("theme-00000000.css")) return SUDOKU_ERR_INVALID_ARG;
+
+    //the rules go to a page buffer with the same writer the inline <style> block uses
+    SudokuPageParts css;
+    sudoku_page_parts_init(&css);
+    put_theme_rules(&css, theme, "");
+    if (css.failed) {
+        sudoku_page_parts_free(&css);
+        return SUDOKU_ERR_NO_MEMORY;
+    }
+
+    //name = fnv-1a of the content
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < css.bytes_len; ++i) {
+        h ^= (unsigned char)css.bytes[i];
+        h *= 16777619u;
+    }
+    char name[32];
+    snprintf(name, sizeof(name), "theme-%08lx.css", (unsigned long)h);
+    char path[1024];
+    join_path(path, sizeof(path), dir, name);
+
+    SudokuResult r = sudoku_page_parts_write_file(&css, path);
+    sudoku_page_parts_free(&css);
+    if (r == SUDOKU_OK) snprintf(out_name, out_size, "%s", name);
+    return r;
+}
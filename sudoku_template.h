@@ -0,0 +1,137 @@
+// sudoku_template.h - user supplied html page templates
+
+//a template is the page html with {{placeholders}} where the puzzle parts go:
+//  {{title}}        page title (escaped)
+//  {{css}}          stylesheet href (escaped)
+//  {{style}}        the theme <style> block (or the <link> to a shared theme css)
+//  {{solution}}     data-solution=" " / data-trace=" " (/ data-puzzle=" ") attributes for the grid container
+//  {{cells}}        the 81 cell divs (compact pages: the <noscript> text grid)
+//  {{difficulty}}   Easy / Medium / Hard links, the current one has class="active"
+//  {{level}}        difficulty name as plain text
+//  {{replay}}       the "Show me" button (only if the page has a solve trace)
+//  {{leaderboard}}  leaderboard <li> items
+//  {{root}}         path to the site root ("" or eg. "../../" for sharded pages), for own links
+//  {{image}}        og:title / og:image meta tags (only if the page has a preview image)
+//block placeholders (style, cells, difficulty, replay, leaderboard, image) write whole lines, so
+//when one stands alone on its line, the indentation and newline around it are dropped
+
+//the template is compiled once into a flat list of ops (copy a span of the template text /
+//fill a slot), writing a page is then just running the list, no parsing or searching per page
+
+//rendering gives a list of parts instead of one buffer: template text is pointed at (shared by
+//all pages, never copied) and only the per page bytes (title, cells, solution ...) go to the
+//page's own buffer. the parts are written with one writev (gather write) where there is one,
+//so the page is never put together in memory
+//(with the built-in template the per page bytes are ~4.9 kb of ~6 kb, nearly all of it the
+//81 cell divs; compact pages (SudokuPageOptions.compact) bring that down to ~0.5 kb)
+
+#ifndef SUDOKU_TEMPLATE_H
+#define SUDOKU_TEMPLATE_H
+
+#include "sudoku_module.h"
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum SudokuSlot {
+    SUDOKU_SLOT_TEXT = -1,      // literal span of the template text
+    SUDOKU_SLOT_TITLE = 0,
+    SUDOKU_SLOT_CSS,
+    SUDOKU_SLOT_STYLE,
+    SUDOKU_SLOT_SOLUTION,
+    SUDOKU_SLOT_CELLS,
+    SUDOKU_SLOT_DIFFICULTY,
+    SUDOKU_SLOT_LEVEL,
+    SUDOKU_SLOT_REPLAY,
+    SUDOKU_SLOT_LEADERBOARD,
+    SUDOKU_SLOT_ROOT,
+    SUDOKU_SLOT_IMAGE,
+    SUDOKU_SLOT_COUNT
+} SudokuSlot;
+
+typedef struct SudokuTemplateOp {
+    int slot;                   // SudokuSlot
+    size_t offset, len;         // span of text (SUDOKU_SLOT_TEXT only)
+} SudokuTemplateOp;
+
+typedef struct SudokuTemplate {
+    char* text;                 // own copy of the template source
+    SudokuTemplateOp* ops;
+    int count;
+    int error_line;             // line of the bad placeholder if compiling failed, else 0
+} SudokuTemplate;
+
+//one piece of a rendered page
+typedef struct SudokuPagePart {
+    const char* text;           // template text, or null = SudokuPageParts.bytes
+    size_t offset, len;
+} SudokuPagePart;
+
+//a rendered page; reuse one for many pages, the buffers only grow
+typedef struct SudokuPageParts {
+    SudokuPagePart* parts;
+    int count, cap;
+    char* bytes;                // per page bytes
+    size_t bytes_len, bytes_cap;
+    int failed;                 // out of memory while rendering
+} SudokuPageParts;
+
+//the built-in page (what sudoku_write_html_page_ex writes), a starting point for own templates
+const char* sudoku_template_default_text(void);
+
+//compiles template source; unknown or unclosed placeholders give SUDOKU_ERR_INVALID_ARG (see error_line)
+SudokuResult sudoku_template_compile(SudokuTemplate* tpl, const char* text);
+
+//reads and compiles a template file
+SudokuResult sudoku_template_load(SudokuTemplate* tpl, const char* path);
+
+void sudoku_template_free(SudokuTemplate* tpl);
+
+void sudoku_page_parts_init(SudokuPageParts* page);
+void sudoku_page_parts_free(SudokuPageParts* page);
+
+//renders a page into parts; they point into tpl->text, so keep the template alive until written
+SudokuResult sudoku_template_render(
+    const SudokuTemplate* tpl,
+    SudokuPageParts* page,
+    const char* css_href,
+    const SudokuBoard* puzzle,
+    const SudokuBoard* out_solution,
+    const SudokuTheme* theme,
+    SudokuDifficulty difficulty,
+    const SudokuPageOptions* options
+);
+
+//total bytes of the page (eg. for a content-length)
+size_t sudoku_page_parts_size(const SudokuPageParts* page);
+
+//writes the parts to a file descriptor (socket, pipe, file) with writev, short writes are continued
+SudokuResult sudoku_page_parts_write_fd(const SudokuPageParts* page, int fd);
+
+//same, into a file: written to a temp file and renamed over path (sudoku_replace_file), so readers never see half a page
+SudokuResult sudoku_page_parts_write_file(const SudokuPageParts* page, const char* path);
+
+//same, for a stdio stream (one fwrite per part)
+SudokuResult sudoku_page_parts_write(const SudokuPageParts* page, FILE* f);
+
+//same parameters as sudoku_write_html_page_ex(), the page layout comes from the template
+//(render + one writev to the file)
+SudokuResult sudoku_template_write_page(
+    const SudokuTemplate* tpl,
+    const char* html_path,
+    const char* css_href,
+    const SudokuBoard* puzzle,
+    const SudokuBoard* out_solution,
+    const SudokuTheme* theme,
+    SudokuDifficulty difficulty,
+    const SudokuPageOptions* options
+);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
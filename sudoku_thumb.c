@@ -0,0 +1,505 @@
+// sudoku_thumb.c - png / svg preview images of puzzles
+
+#include "sudoku_thumb.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_THREADS 64
+
+//5x7 digits, one row per byte, bit 4 = left column
+static const unsigned char font5x7[10][7] = {
+    {0x0e, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0e},
+    {0x04, 0x0c, 0x04, 0x04, 0x04, 0x04, 0x0e},
+    {0x0e, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1f},
+    {0x1f, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0e},
+    {0x02, 0x06, 0x0a, 0x12, 0x1f, 0x02, 0x02},
+    {0x1f, 0x10, 0x1e, 0x01, 0x01, 0x11, 0x0e},
+    {0x06, 0x08, 0x10, 0x1e, 0x11, 0x11, 0x0e},
+    {0x1f, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08},
+    {0x0e, 0x11, 0x11, 0x0e, 0x11, 0x11, 0x0e},
+    {0x0e, 0x11, 0x11, 0x0f, 0x01, 0x02, 0x0c}
+};
+
+//where things go in a size x size image
+typedef struct Layout {
+    int size;
+    int origin;                 // left / top of the grid
+    int cell;                   // cell pitch in pixels
+    int thin, thick;            // line widths
+    int glyph_w, glyph_h;
+} Layout;
+
+static void make_layout(int size, Layout* l) {
+    int margin = size / 24 > 1 ? size / 24 : 1;
+    l->size = size;
+    l->cell = (size - 2 * margin) / 9;
+    l->origin = (size - 9 * l->cell) / 2;
+    l->thin = l->cell / 24 > 1 ? l->cell / 24 : 1;
+    l->thick = l->cell / 8 > 2 ? l->cell / 8 : 2;
+    l->glyph_h = l->cell * 3 / 5;
+    l->glyph_w = (l->glyph_h * 5 + 6) / 7;
+}
+
+//glyph atlas: the 9 digits at one size, 0 = ink, 255 = paper
+
+typedef struct Atlas {
+    int w, h;
+    unsigned char* px;          // 10 glyphs of w * h, one after another
+} Atlas;
+
+static SudokuResult atlas_build(Atlas* a, const Layout* l) {
+    a->w = l->glyph_w;
+    a->h = l->glyph_h;
+    a->px = (unsigned char*)malloc((size_t)10 * a->w * a->h);
+    if (!a->px) return SUDOKU_ERR_NO_MEMORY;
+    for (int d = 0; d < 10; ++d) {
+        unsigned char* g = a->px + (size_t)d * a->w * a->h;
+        for (int y = 0; y < a->h; ++y) {
+            for (int x = 0; x < a->w; ++x) {
+                //4x4 samples per pixel, coverage -> gray
+                int hits = 0;
+                for (int sy = 0; sy < 4; ++sy) {
+                    int fy = ((y * 4 + sy) * 7) / (a->h * 4);
+                    for (int sx = 0; sx < 4; ++sx) {
+                        int fx = ((x * 4 + sx) * 5) / (a->w * 4);
+                        hits += (font5x7[d][fy] >> (4 - fx)) & 1;
+                    }
+                }
+                g[y * a->w + x] = (unsigned char)(255 - hits * 255 / 16);
+            }
+        }
+    }
+    return SUDOKU_OK;
+}
+
+static void atlas_free(Atlas* a) {
+    free(a->px);
+    a->px = NULL;
+}
+
+//drawing (8 bit gray, row-major)
+
+static void fill_rect(unsigned char* img, int size, int x, int y, int w, int h, unsigned char v) {
+    if (x < 0) { w += x; x = 0; }
+    if (y < 0) { h += y; y = 0; }
+    if (x + w > size) w = size - x;
+    if (y + h > size) h = size - y;
+    for (int r = y; r < y + h; ++r) memset(img + (size_t)r * size + x, v, (size_t)(w > 0 ? w : 0));
+}
+
+static void draw_board(unsigned char* img, const Layout* l, const Atlas* a, const SudokuBoard* puzzle) {
+    memset(img, 255, (size_t)l->size * l->size);
+    int span = 9 * l->cell;
+    for (int k = 0; k <= 9; ++k) {
+        int w = (k % 3 == 0) ? l->thick : l->thin;
+        int at = l->origin + k * l->cell - w / 2;
+        fill_rect(img, l->size, at, l->origin - l->thick / 2, w, span + l->thick, 0);
+        fill_rect(img, l->size, l->origin - l->thick / 2, at, span + l->thick, w, 0);
+    }
+    for (int r = 0; r < 9; ++r) {
+        for (int c = 0; c < 9; ++c) {
+            int v = puzzle->cell[r][c];
+            if (v < 1 || v > 9) continue;
+            const unsigned char* g = a->px + (size_t)v * a->w * a->h;
+            int x0 = l->origin + c * l->cell + (l->cell - a->w) / 2;
+            int y0 = l->origin + r * l->cell + (l->cell - a->h) / 2;
+            for (int y = 0; y < a->h; ++y) {
+                unsigned char* row = img + (size_t)(y0 + y) * l->size + x0;
+                const unsigned char* grow = g + y * a->w;
+                for (int x = 0; x < a->w; ++x) {
+                    if (grow[x] < row[x]) row[x] = grow[x];
+                }
+            }
+        }
+    }
+}
+
+//png encoder
+
+typedef struct Bytes {
+    unsigned char* data;
+    size_t len, cap;
+    int failed;
+    uint32_t bits;              // deflate bit writer
+    int nbits;
+} Bytes;
+
+static void bytes_reserve(Bytes* b, size_t extra) {
+    if (b->failed || b->len + extra <= b->cap) return;
+    size_t ncap = b->cap ? b->cap : 4096;
+    while (ncap < b->len + extra) ncap *= 2;
+    unsigned char* nd = (unsigned char*)realloc(b->data, ncap);
+    if (!nd) {
+        b->failed = 1;
+        return;
+    }
+    b->data = nd;
+    b->cap = ncap;
+}
+
+static void put_byte(Bytes* b, unsigned char v) {
+    bytes_reserve(b, 1);
+    if (!b->failed) b->data[b->len++] = v;
+}
+
+static void put_be32(Bytes* b, uint32_t v) {
+    for (int i = 3; i >= 0; --i) put_byte(b, (unsigned char)(v >> (8 * i)));
+}
+
+//deflate bits go out lsb first
+static void put_bits(Bytes* b, uint32_t v, int n) {
+    b->bits |= v << b->nbits;
+    b->nbits += n;
+    while (b->nbits >= 8) {
+        put_byte(b, (unsigned char)(b->bits & 0xff));
+        b->bits >>= 8;
+        b->nbits -= 8;
+    }
+}
+
+//huffman codes are stored msb first
+static void put_code(Bytes* b, uint32_t code, int n) {
+    uint32_t rev = 0;
+    for (int i = 0; i < n; ++i) rev |= ((code >> i) & 1) << (n - 1 - i);
+    put_bits(b, rev, n);
+}
+
+//fixed huffman code of a literal / length symbol (rfc 1951 3.2.6)
+static void put_symbol(Bytes* b, int sym) {
+    if (sym < 144) put_code(b, 0x30 + (uint32_t)sym, 8);
+    else if (sym < 256) put_code(b, 0x190 + (uint32_t)(sym - 144), 9);
+    else if (sym < 280) put_code(b, (uint32_t)(sym - 256), 7);
+    else put_code(b, 0xc0 + (uint32_t)(sym - 280), 8);
+}
+
+static const int len_base[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const int len_extra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+
+//match of `len` bytes (3..258) at distance 1 (distance code 0, no extra bits)
+static void put_run(Bytes* b, int len) {
+    int i = 28;
+    while (len_base[i] > len) --i;
+    put_symbol(b, 257 + i);
+    if (len_extra[i]) put_bits(b, (uint32_t)(len - len_base[i]), len_extra[i]);
+    put_code(b, 0, 5);
+}
+
+//one fixed huffman block; only runs of one byte are matched (after the up filter
+//that is nearly everything in a flat image)
+static void deflate_runs(Bytes* b, const unsigned char* p, size_t n) {
+    put_bits(b, 1, 1);          // final block
+    put_bits(b, 1, 2);          // fixed huffman
+    size_t i = 0;
+    while (i < n) {
+        put_symbol(b, p[i]);
+        size_t j = i + 1;
+        while (j < n && p[j] == p[i]) ++j;
+        size_t run = j - i - 1;  // repeats after the literal
+        while (run >= 3) {
+            int len = run > 258 ? 258 : (int)run;
+            if (run - (size_t)len > 0 && run - (size_t)len < 3 && len > 3) len -= 3;
+            put_run(b, len);
+            run -= (size_t)len;
+        }
+        for (size_t k = 0; k < run; ++k) put_symbol(b, p[i]);
+        i = j;
+    }
+    put_symbol(b, 256);
+    if (b->nbits > 0) put_bits(b, 0, 8 - b->nbits);
+}
+
+//crc32 (the zip/png one), 4 bits at a time so the table stays small
+static uint32_t crc32_update(uint32_t crc, const unsigned char* p, size_t n) {
+    static const uint32_t nibble[16] = {
+        0x00000000u, 0x1db71064u, 0x3b6e20c8u, 0x26d930acu, 0x76dc4190u, 0x6b6b51f4u, 0x4db26158u, 0x5005713cu,
+        0xedb88320u, 0xf00f9344u, 0xd6d6a3e8u, 0xcb61b38cu, 0x9b64c2b0u, 0x86d3d2d4u, 0xa00ae278u, 0xbdbdf21cu
+    };
+    crc = ~crc;
+    for (size_t i = 0; i < n; ++i) {
+        crc ^= p[i];
+        crc = (crc >> 4) ^ nibble[crc & 15];
+        crc = (crc >> 4) ^ nibble[crc & 15];
+    }
+    return ~crc;
+}
+
+static uint32_t adler32(const unsigned char* p, size_t n) {
+    uint32_t a = 1, s = 0;
+    for (size_t i = 0; i < n; ++i) {
+        a = (a + p[i]) % 65521u;
+        s = (s + a) % 65521u;
+    }
+    return s << 16 | a;
+}
+
+//chunk = length, type, data, crc of type + data
+static void put_chunk(Bytes* b, const char* type, const unsigned char* data, size_t n) {
+    put_be32(b, (uint32_t)n);
+    size_t start = b->len;
+    for (int i = 0; i < 4; ++i) put_byte(b, (unsigned char)type[i]);
+    bytes_reserve(b, n);
+    if (b->failed) return;
+    if (n) memcpy(b->data + b->len, data, n);
+    b->len += n;
+    put_be32(b, crc32_update(0, b->data + start, 4 + n));
+}
+
+//per thread buffers, reused for every image
+typedef struct Canvas {
+    unsigned char* img;         // size * size
+    unsigned char* rows;        // filtered rows: size * (size + 1)
+    Bytes z;                    // zlib stream
+    Bytes png;
+} Canvas;
+
+static SudokuResult canvas_init(Canvas* cv, int size) {
+    memset(cv, 0, sizeof(*cv));
+    cv->img = (unsigned char*)malloc((size_t)size * size);
+    cv->rows = (unsigned char*)malloc((size_t)size * (size + 1));
+    return (cv->img && cv->rows) ? SUDOKU_OK : SUDOKU_ERR_NO_MEMORY;
+}
+
+static void canvas_free(Canvas* cv) {
+    free(cv->img);
+    free(cv->rows);
+    free(cv->z.data);
+    free(cv->png.data);
+    memset(cv, 0, sizeof(*cv));
+}
+
+//files are written to a temp file and renamed over path when complete, so a web server serving
+//the folder never sends half an image
+static SudokuResult close_temp(FILE* f, const char* tmp, const char* path) {
+    SudokuResult r = ferror(f) ? SUDOKU_ERR_IO : SUDOKU_OK;
+    if (fclose(f) != 0) r = SUDOKU_ERR_IO;
+    if (r != SUDOKU_OK) {
+        remove(tmp);
+        return r;
+    }
+    return sudoku_replace_file(tmp, path);
+}
+
+//png of the puzzle into cv->png
+static SudokuResult encode_png(Canvas* cv, const Layout* l, const Atlas* a, const SudokuBoard* puzzle) {
+    int size = l->size;
+    draw_board(cv->img, l, a, puzzle);
+
+    //filter: first row as is, then "up" (difference to the row above)
+    size_t stride = (size_t)size + 1;
+    for (int y = 0; y < size; ++y) {
+        unsigned char* out = cv->rows + (size_t)y * stride;
+        const unsigned char* row = cv->img + (size_t)y * size;
+        if (y == 0) {
+            out[0] = 0;
+            memcpy(out + 1, row, (size_t)size);
+        } else {
+            out[0] = 2;
+            for (int x = 0; x < size; ++x) out[1 + x] = (unsigned char)(row[x] - row[x - size]);
+        }
+    }
+    size_t raw = stride * size;
+
+    Bytes* z = &cv->z;
+    z->len = 0;
+    z->bits = 0;
+    z->nbits = 0;
+    z->failed = 0;
+    put_byte(z, 0x78);
+    put_byte(z, 0x01);
+    deflate_runs(z, cv->rows, raw);
+    put_be32(z, adler32(cv->rows, raw));
+
+    Bytes* png = &cv->png;
+    png->len = 0;
+    png->failed = 0;
+    static const unsigned char signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    bytes_reserve(png, sizeof(signature));
+    if (!png->failed) {
+        memcpy(png->data, signature, sizeof(signature));
+        png->len = sizeof(signature);
+    }
+    unsigned char ihdr[13] = {0};
+    for (int i = 0; i < 4; ++i) {
+        ihdr[i] = (unsigned char)((uint32_t)size >> (24 - 8 * i));
+        ihdr[4 + i] = ihdr[i];
+    }
+    ihdr[8] = 8;                // bit depth
+    ihdr[9] = 0;                // grayscale
+    put_chunk(png, "IHDR", ihdr, sizeof(ihdr));
+    if (!z->failed) put_chunk(png, "IDAT", z->data, z->len);
+    put_chunk(png, "IEND", NULL, 0);
+    return (z->failed || png->failed) ? SUDOKU_ERR_NO_MEMORY : SUDOKU_OK;
+}
+
+static SudokuResult write_png(Canvas* cv, const Layout* l, const Atlas* a, const SudokuBoard* puzzle, const char* path) {
+    SudokuResult r = encode_png(cv, l, a, puzzle);
+    if (r != SUDOKU_OK) return r;
+    char tmp[1040];
+    FILE* f = sudoku_temp_path(path, tmp, sizeof(tmp)) ? fopen(tmp, "wb") : NULL;
+    if (!f) return SUDOKU_ERR_IO;
+    fwrite(cv->png.data, 1, cv->png.len, f);
+    return close_temp(f, tmp, path);
+}
+
+SudokuResult sudoku_thumb_png(const SudokuBoard* puzzle, int size, const char* path) {
+    SudokuThumbJob job;
+    job.puzzle = puzzle;
+    job.path = path;
+    return sudoku_thumb_batch(&job, 1, size, 1);
+}
+
+//writer (one thread, many images)
+
+struct SudokuThumbState {
+    Layout layout;
+    Atlas atlas;
+    Canvas canvas;
+};
+
+SudokuResult sudoku_thumb_writer_init(SudokuThumbWriter* w, int size) {
+    if (!w) return SUDOKU_ERR_INVALID_ARG;
+    w->size = size;
+    w->state = NULL;
+    if (size < SUDOKU_THUMB_MIN_SIZE || size > SUDOKU_THUMB_MAX_SIZE) return SUDOKU_ERR_INVALID_ARG;
+    struct SudokuThumbState* st = (struct SudokuThumbState*)calloc(1, sizeof(*st));
+    if (!st) return SUDOKU_ERR_NO_MEMORY;
+    make_layout(size, &st->layout);
+    SudokuResult r = atlas_build(&st->atlas, &st->layout);
+    if (r == SUDOKU_OK) r = canvas_init(&st->canvas, size);
+    w->state = st;
+    if (r != SUDOKU_OK) sudoku_thumb_writer_free(w);
+    return r;
+}
+
+SudokuResult sudoku_thumb_writer_encode(SudokuThumbWriter* w, const SudokuBoard* puzzle, const unsigned char** out, size_t* out_len) {
+    if (!w || !w->state || !puzzle || !out || !out_len) return SUDOKU_ERR_INVALID_ARG;
+    struct SudokuThumbState* st = w->state;
+    SudokuResult r = encode_png(&st->canvas, &st->layout, &st->atlas, puzzle);
+    *out = r == SUDOKU_OK ? st->canvas.png.data : NULL;
+    *out_len = r == SUDOKU_OK ? st->canvas.png.len : 0;
+    return r;
+}
+
+SudokuResult sudoku_thumb_writer_png(SudokuThumbWriter* w, const SudokuBoard* puzzle, const char* path) {
+    if (!w || !w->state || !puzzle || !path) return SUDOKU_ERR_INVALID_ARG;
+    struct SudokuThumbState* st = w->state;
+    return write_png(&st->canvas, &st->layout, &st->atlas, puzzle, path);
+}
+
+void sudoku_thumb_writer_free(SudokuThumbWriter* w) {
+    if (!w || !w->state) return;
+    atlas_free(&w->state->atlas);
+    canvas_free(&w->state->canvas);
+    free(w->state);
+    w->state = NULL;
+}
+
+//batch
+
+typedef struct ThumbWorker {
+    SudokuThumbJob* jobs;
+    int count;
+    int first, step;            // jobs first, first + step, ...
+    const Layout* layout;
+    const Atlas* atlas;
+    int size;
+} ThumbWorker;
+
+static void* thumb_thread(void* arg) {
+    ThumbWorker* w = (ThumbWorker*)arg;
+    Canvas cv;
+    SudokuResult r = canvas_init(&cv, w->size);
+    for (int i = w->first; i < w->count; i += w->step) {
+        SudokuThumbJob* job = &w->jobs[i];
+        if (r != SUDOKU_OK) job->result = r;
+        else if (!job->puzzle || !job->path) job->result = SUDOKU_ERR_INVALID_ARG;
+        else job->result = write_png(&cv, w->layout, w->atlas, job->puzzle, job->path);
+    }
+    canvas_free(&cv);
+    return NULL;
+}
+
+SudokuResult sudoku_thumb_batch(SudokuThumbJob* jobs, int count, int size, int threads) {
+    if ((!jobs && count > 0) || count < 0) return SUDOKU_ERR_INVALID_ARG;
+    if (size < SUDOKU_THUMB_MIN_SIZE || size > SUDOKU_THUMB_MAX_SIZE) return SUDOKU_ERR_INVALID_ARG;
+    if (threads < 1) threads = 1;
+    if (threads > MAX_THREADS) threads = MAX_THREADS;
+    if (threads > count) threads = count > 0 ? count : 1;
+
+    Layout l;
+    make_layout(size, &l);
+    Atlas atlas;
+    SudokuResult r = atlas_build(&atlas, &l);
+    if (r != SUDOKU_OK) return r;
+
+    ThumbWorker workers[MAX_THREADS];
+    pthread_t tids[MAX_THREADS];
+    int started = 0;
+    for (int i = 0; i < threads; ++i) {
+        workers[i].jobs = jobs;
+        workers[i].count = count;
+        workers[i].first = i;
+        workers[i].step = threads;
+        workers[i].layout = &l;
+        workers[i].atlas = &atlas;
+        workers[i].size = size;
+    }
+    //the calling thread takes the first share
+    for (int i = 1; i < threads; ++i) {
+        if (pthread_create(&tids[i], NULL, thumb_thread, &workers[i]) != 0) break;
+        ++started;
+    }
+    //shares of threads that did not start go to this thread too
+    for (int i = started + 1; i < threads; ++i) thumb_thread(&workers[i]);
+    thumb_thread(&workers[0]);
+    for (int i = 1; i <= started; ++i) pthread_join(tids[i], NULL);
+    atlas_free(&atlas);
+
+    for (int i = 0; i < count; ++i) {
+        if (jobs[i].result != SUDOKU_OK) return jobs[i].result;
+    }
+    return SUDOKU_OK;
+}
+
+//svg
+
+SudokuResult sudoku_thumb_svg(const SudokuBoard* puzzle, int size, const char* path) {
+    if (!puzzle || !path || size < SUDOKU_THUMB_MIN_SIZE || size > SUDOKU_THUMB_MAX_SIZE) return SUDOKU_ERR_INVALID_ARG;
+    Layout l;
+    make_layout(size, &l);
+    char tmp[1040];
+    FILE* f = sudoku_temp_path(path, tmp, sizeof(tmp)) ? fopen(tmp, "w") : NULL;
+    if (!f) return SUDOKU_ERR_IO;
+
+    int o = l.origin, span = 9 * l.cell;
+    fprintf(f, "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"%d\" height=\"%d\" viewBox=\"0 0 %d %d\">\n", size, size, size, size);
+    fputs("<rect width=\"100%\" height=\"100%\" fill=\"#fff\"/>\n", f);
+    for (int pass = 0; pass < 2; ++pass) {
+        //thin lines, then the box lines over them
+        fprintf(f, "<path stroke=\"#000\" stroke-width=\"%d\" d=\"", pass ? l.thick : l.thin);
+        for (int k = 0; k <= 9; ++k) {
+            if ((k % 3 == 0) != (pass == 1)) continue;
+            int at = o + k * l.cell;
+            fprintf(f, "M%d %dV%dM%d %dH%d", at, o, o + span, o, at, o + span);
+        }
+        fputs("\"/>\n", f);
+    }
+    fprintf(f, "<g font-family=\"sans-serif\" font-weight=\"bold\" font-size=\"%d\" text-anchor=\"middle\" dominant-baseline=\"central\">\n",
+        l.glyph_h * 4 / 3);
+    for (int r = 0; r < 9; ++r) {
+        for (int c = 0; c < 9; ++c) {
+            int v = puzzle->cell[r][c];
+            if (v < 1 || v > 9) continue;
+            fprintf(f, "<text x=\"%d\" y=\"%d\">%d</text>\n", o + c * l.cell + l.cell / 2, o + r * l.cell + l.cell / 2, v);
+        }
+    }
+    fputs("</g>\n</svg>\n", f);
+    return close_temp(f, tmp, path);
+}
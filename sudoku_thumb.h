@@ -0,0 +1,61 @@
+// sudoku_thumb.h - png / svg preview images of puzzles
+
+//for social previews (og:image) and archive thumbnails, straight from a SudokuBoard, no browser
+//png: 8 bit grayscale, written by a small built-in encoder (rows with the "up" filter,
+//deflate with run length matches and the fixed huffman codes, zlib + crc chunks), so flat
+//images like these end up a few kb
+//digits come from a glyph atlas: a 5x7 bitmap font rasterized (anti-aliased) once per image
+//size, then every clue is a copy of its glyph
+
+#ifndef SUDOKU_THUMB_H
+#define SUDOKU_THUMB_H
+
+#include "sudoku_module.h"
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SUDOKU_THUMB_MIN_SIZE 36
+#define SUDOKU_THUMB_MAX_SIZE 4096
+
+typedef struct SudokuThumbJob {
+    const SudokuBoard* puzzle;
+    const char* path;
+    SudokuResult result;        // set by sudoku_thumb_batch
+} SudokuThumbJob;
+
+//square png of size x size pixels (builds the atlas for this one image; for many, use a writer
+//or sudoku_thumb_batch)
+SudokuResult sudoku_thumb_png(const SudokuBoard* puzzle, int size, const char* path);
+
+//the same picture as svg (scales to any size, text digits)
+SudokuResult sudoku_thumb_svg(const SudokuBoard* puzzle, int size, const char* path);
+
+//many pngs of one size on one thread: the glyph atlas and the buffers are made once at init
+typedef struct SudokuThumbWriter {
+    int size;
+    struct SudokuThumbState* state;  // atlas + buffers (sudoku_thumb.c)
+} SudokuThumbWriter;
+
+SudokuResult sudoku_thumb_writer_init(SudokuThumbWriter* w, int size);
+
+//encodes a png into the writer's buffer, no file (eg. to send it); *out stays valid until the next call
+SudokuResult sudoku_thumb_writer_encode(SudokuThumbWriter* w, const SudokuBoard* puzzle, const unsigned char** out, size_t* out_len);
+
+//encodes and writes to path (temp file + rename, like sudoku_thumb_png)
+SudokuResult sudoku_thumb_writer_png(SudokuThumbWriter* w, const SudokuBoard* puzzle, const char* path);
+
+void sudoku_thumb_writer_free(SudokuThumbWriter* w);
+
+//renders many pngs of one size on `threads` threads (the atlas is built once and shared)
+//every job gets its result; returns SUDOKU_OK or the first failure
+SudokuResult sudoku_thumb_batch(SudokuThumbJob* jobs, int count, int size, int threads);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif